@@ -0,0 +1,337 @@
+/*** includes ***/
+
+#include "../kilo.h"
+
+/*** defines ***/
+
+#define BENCH_ROWS 50
+#define BENCH_COLS 160
+#define BENCH_MAX_KEYS 8192
+#define BENCH_MACRO_REPLAYS 100000
+
+/*** data ***/
+
+// A trace is a scripted sequence of keys fed to the editor through
+// bench_terminal. Each key is one operation, timed from the moment
+// editor_read_key hands it over until the editor asks for the next one, so
+// the latency covers processing the key and repainting the screen.
+struct bench_trace {
+  char *name;
+  int keys[BENCH_MAX_KEYS];
+  int num_keys;
+  int next;
+  double op_start;
+  double *latencies;
+  int num_latencies;
+};
+
+struct bench_trace *bench_current;
+long bench_bytes_written;
+
+char *bench_lines[] = {
+  "static int parse_header(struct header *h, const char *buf, int len) {",
+  "  for (int i = 0; i < len; i++) { if (buf[i] == '\\n') return i + 1; }",
+  "  double ratio = (double)h->count / 3.14159 + 2.71828 * h->scale;",
+  "\twhile (h->next != NULL && h->flags & 0x10) { h = h->next; }",
+  "  char *msg = \"unexpected token in header, expected ':' or ';'\";",
+  "  // unsigned long offsets break on files larger than 4 GB",
+  "  switch (h->kind) { case 1: return 42; case 2: break; "
+    "default: return -1; }",
+  "}",
+};
+
+#define BENCH_LINE_KINDS (sizeof(bench_lines) / sizeof(bench_lines[0]))
+
+int bench_default_sizes[] = { 1000, 10000, 100000, 1000000 };
+
+#define BENCH_DEFAULT_SIZES \
+  (sizeof(bench_default_sizes) / sizeof(bench_default_sizes[0]))
+
+/*** terminal ***/
+
+double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void bench_end_op(struct bench_trace *trace) {
+  if (trace->op_start != 0) {
+    trace->latencies[trace->num_latencies++] = bench_now() - trace->op_start;
+    trace->op_start = 0;
+  }
+}
+
+int bench_read_key(void) {
+  struct bench_trace *trace = bench_current;
+  bench_end_op(trace);
+  if (trace->next == trace->num_keys) {
+    die("bench trace ran out of keys");
+  }
+  int c = trace->keys[trace->next++];
+  trace->op_start = bench_now();
+  return c;
+}
+
+void bench_write(const char *buffer, int length) {
+  (void)buffer;
+  bench_bytes_written += length;
+}
+
+int bench_get_window_size(int *rows, int *cols) {
+  *rows = BENCH_ROWS;
+  *cols = BENCH_COLS;
+  return 0;
+}
+
+struct editor_terminal bench_terminal = {
+  bench_read_key,
+  bench_write,
+  bench_get_window_size,
+  NULL
+};
+
+/*** traces ***/
+
+void bench_trace_key(struct bench_trace *trace, int c) {
+  if (trace->num_keys < BENCH_MAX_KEYS) {
+    trace->keys[trace->num_keys++] = c;
+  }
+}
+
+void bench_trace_string(struct bench_trace *trace, const char *s) {
+  while (*s) {
+    bench_trace_key(trace, *s++);
+  }
+}
+
+void bench_trace_page_down(struct bench_trace *trace) {
+  trace->name = "page-down";
+  int j;
+  for (j = 0; j < 500; j++) {
+    bench_trace_key(trace, PAGE_DOWN);
+  }
+}
+
+void bench_trace_search(struct bench_trace *trace) {
+  trace->name = "search";
+  int j;
+  for (j = 0; j < 20; j++) {
+    bench_trace_key(trace, CTRL_KEY('f'));
+    bench_trace_string(trace, "ratio");
+    bench_trace_key(trace, ARROW_DOWN);
+    bench_trace_key(trace, ARROW_DOWN);
+    bench_trace_key(trace, '\r');
+  }
+}
+
+void bench_trace_typing(struct bench_trace *trace) {
+  trace->name = "typing";
+  int j;
+  for (j = 0; j < 40; j++) {
+    bench_trace_string(trace, "total += values[i] * scale; ");
+    bench_trace_key(trace, BACKSPACE);
+    bench_trace_key(trace, BACKSPACE);
+    bench_trace_string(trace, " ");
+    if (j % 4 == 3) {
+      bench_trace_key(trace, '\r');
+    }
+  }
+}
+
+void bench_trace_paste(struct bench_trace *trace) {
+  trace->name = "paste";
+  int j;
+  for (j = 0; j < 100; j++) {
+    bench_trace_string(trace, bench_lines[j % BENCH_LINE_KINDS]);
+    bench_trace_key(trace, '\r');
+  }
+}
+
+// Pages down with soft wrap on, where scrolling goes through the line
+// counts instead of straight to a row.
+void bench_trace_wrap(struct bench_trace *trace) {
+  trace->name = "wrap-page";
+  bench_trace_key(trace, CTRL_KEY('t'));
+  int j;
+  for (j = 0; j < 500; j++) {
+    bench_trace_key(trace, PAGE_DOWN);
+  }
+  bench_trace_key(trace, CTRL_KEY('t'));
+}
+
+// Records a 20-key macro that edits the current line and moves to the next.
+void bench_trace_macro(struct bench_trace *trace) {
+  trace->name = "macro";
+  bench_trace_key(trace, CTRL_KEY('k'));
+  bench_trace_key(trace, HOME_KEY);
+  bench_trace_string(trace, "// ");
+  bench_trace_key(trace, END_KEY);
+  bench_trace_string(trace, " x+= 1;");
+  bench_trace_key(trace, BACKSPACE);
+  bench_trace_key(trace, ';');
+  bench_trace_key(trace, ARROW_DOWN);
+  bench_trace_key(trace, HOME_KEY);
+  bench_trace_key(trace, ARROW_RIGHT);
+  bench_trace_key(trace, ARROW_RIGHT);
+  bench_trace_key(trace, ARROW_LEFT);
+  bench_trace_key(trace, ARROW_LEFT);
+  bench_trace_key(trace, CTRL_KEY('k'));
+}
+
+/*** bench ***/
+
+int bench_compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+char *bench_generate_file(int lines) {
+  char *filename = strdup("/tmp/kilo-bench-XXXXXX.c");
+  int fd = mkstemps(filename, 2);
+  if (fd == -1) {
+    die("mkstemps");
+  }
+
+  FILE *fp = fdopen(fd, "w");
+  if (fp == NULL) {
+    die("fdopen");
+  }
+  int j;
+  for (j = 0; j < lines; j++) {
+    fprintf(fp, "%s\n", bench_lines[j % BENCH_LINE_KINDS]);
+  }
+  fclose(fp);
+  return filename;
+}
+
+void bench_run(struct bench_trace *trace) {
+  trace->next = 0;
+  trace->op_start = 0;
+  trace->num_latencies = 0;
+  trace->latencies = malloc(sizeof(double) * trace->num_keys);
+  bench_current = trace;
+  bench_bytes_written = 0;
+
+  double start = bench_now();
+  while (trace->next < trace->num_keys) {
+    editor_refresh_screen();
+    editor_process_keypress();
+  }
+  editor_refresh_screen();
+  bench_end_op(trace);
+  double elapsed = bench_now() - start;
+
+  qsort(
+    trace->latencies,
+    trace->num_latencies,
+    sizeof(double),
+    bench_compare_double);
+  double p50 = trace->latencies[trace->num_latencies / 2];
+  double p99 = trace->latencies[trace->num_latencies * 99 / 100];
+
+  printf(
+    "  %-10s %6d ops %10.0f ops/s   p50 %9.1f us   p99 %9.1f us"
+    "   %8.1f KB written\n",
+    trace->name,
+    trace->num_latencies,
+    trace->num_latencies / elapsed,
+    p50 * 1e6,
+    p99 * 1e6,
+    bench_bytes_written / 1024.0);
+
+  free(trace->latencies);
+}
+
+// Replays the macro once per line, up to BENCH_MACRO_REPLAYS times, as a
+// single batch followed by one redraw.
+void bench_macro(int lines) {
+  struct bench_trace *trace = calloc(1, sizeof(struct bench_trace));
+  bench_trace_macro(trace);
+  trace->latencies = malloc(sizeof(double) * trace->num_keys);
+  bench_current = trace;
+  E.cursor_x = 0;
+  E.cursor_y = 0;
+  E.row_offset = 0;
+  while (trace->next < trace->num_keys) {
+    editor_process_keypress();
+  }
+  bench_end_op(trace);
+
+  int replays = lines - 1 < BENCH_MACRO_REPLAYS ?
+    lines - 1 :
+    BENCH_MACRO_REPLAYS;
+  double start = bench_now();
+  editor_macro_replay(replays);
+  editor_refresh_screen();
+  double elapsed = bench_now() - start;
+
+  printf(
+    "  %-10s %6d replays of %d keys in %.3f s   %10.0f keys/s\n",
+    trace->name,
+    replays,
+    E.macro.num_keys,
+    elapsed,
+    (double)replays * E.macro.num_keys / elapsed);
+
+  free(trace->latencies);
+  free(trace);
+}
+
+void bench_size(int lines) {
+  char *filename = bench_generate_file(lines);
+
+  double start = bench_now();
+  editor_open(filename);
+  double first_screen = bench_now() - start;
+  editor_wait_rows(INT_MAX);
+  double load = bench_now() - start;
+  printf(
+    "%d lines: editor_open %.3f s, fully indexed %.3f s\n",
+    lines,
+    first_screen,
+    load);
+
+  void (*builders[])(struct bench_trace *) = {
+    bench_trace_page_down,
+    bench_trace_search,
+    bench_trace_typing,
+    bench_trace_paste,
+    bench_trace_wrap
+  };
+  unsigned int j;
+  for (j = 0; j < sizeof(builders) / sizeof(builders[0]); j++) {
+    struct bench_trace *trace = calloc(1, sizeof(struct bench_trace));
+    builders[j](trace);
+
+    E.cursor_x = 0;
+    E.cursor_y = (j == 0) ? 0 : E.num_rows / 2;
+    E.row_offset = E.cursor_y;
+    bench_run(trace);
+    free(trace);
+  }
+
+  bench_macro(lines);
+
+  editor_close();
+  unlink(filename);
+  free(filename);
+}
+
+int main(int argc, char *argv[]) {
+  init_editor(&bench_terminal);
+
+  if (argc > 1) {
+    int j;
+    for (j = 1; j < argc; j++) {
+      bench_size(atoi(argv[j]));
+    }
+  } else {
+    unsigned int j;
+    for (j = 0; j < BENCH_DEFAULT_SIZES; j++) {
+      bench_size(bench_default_sizes[j]);
+    }
+  }
+  return 0;
+}
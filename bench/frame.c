@@ -0,0 +1,73 @@
+/*** includes ***/
+
+#include "../kilo.h"
+
+/*** defines ***/
+
+#define BENCH_ROWS 60
+#define BENCH_COLS 200
+#define BENCH_FILE_ROWS 2000
+#define BENCH_FRAMES 20000
+
+/*** data ***/
+
+char *bench_lines[] = {
+  "static int parse_header(struct header *h, const char *buf, int len) {",
+  "  for (int i = 0; i < len; i++) { if (buf[i] == '\\n') return i + 1; }",
+  "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+  "  double ratio = (double)h->count / 3.14159 + 2.71828 * h->scale;",
+  "  while (h->next != NULL && h->flags & 0x10) { h = h->next; }",
+  "  char *msg = \"unexpected token in header, expected ':' or ';'\";",
+  "  // TODO: unsigned long offsets break on files larger than 4 GB",
+  "  switch (h->kind) { case 1: return 42; case 2: break; "
+    "default: return -1; }",
+};
+
+#define BENCH_LINE_KINDS (sizeof(bench_lines) / sizeof(bench_lines[0]))
+
+/*** bench ***/
+
+double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  E.screen_rows = BENCH_ROWS;
+  E.screen_cols = BENCH_COLS;
+  E.filename = strdup("bench.c");
+  editor_init_sgr();
+  editor_select_syntax_highlight();
+
+  // Pad every line past the screen width so each frame is full.
+  char line[BENCH_COLS * 2];
+  for (int i = 0; i < BENCH_FILE_ROWS; i++) {
+    char *text = bench_lines[i % BENCH_LINE_KINDS];
+    int len = 0;
+    while (len < BENCH_COLS + 16) {
+      len += snprintf(&line[len], sizeof(line) - len, "%s ", text);
+    }
+    editor_insert_row(E.num_rows, line, BENCH_COLS + 16);
+  }
+
+  long bytes = 0;
+  double start = bench_now();
+  for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+    struct append_buffer append_buffer = APPEND_BUFFER_INIT;
+    E.row_offset = frame % (BENCH_FILE_ROWS - BENCH_ROWS);
+    E.col_offset = frame % 8;
+    editor_draw_rows(&append_buffer);
+    bytes += append_buffer.length;
+    append_buffer_free(&append_buffer);
+  }
+  double elapsed = bench_now() - start;
+
+  printf(
+    "editor_draw_rows %dx%d: %.2f us/frame, %.1f MB/s of output\n",
+    BENCH_COLS,
+    BENCH_ROWS,
+    elapsed * 1e6 / BENCH_FRAMES,
+    bytes / elapsed / 1e6);
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*** includes ***/
+
+#include "../kilo.h"
+
+/*** defines ***/
+
+#define BENCH_RUNS 3
+#define BENCH_DIRS 64
+#define BENCH_FILES 32
+#define BENCH_FILE_LINES 2000
+
+/*** data ***/
+
+char *bench_lines[] = {
+  "static int parse_header(struct header *h, const char *buf, int len) {",
+  "  for (int i = 0; i < len; i++) { if (buf[i] == '\\n') return i + 1; }",
+  "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+  "  double ratio = (double)h->count / 3.14159 + 2.71828 * h->scale;",
+  "\twhile (h->next != NULL && h->flags & 0x10) { h = h->next; }",
+  "  char *msg = \"unexpected token in header, expected ':' or ';'\";",
+  "",
+  "}",
+};
+
+#define BENCH_LINE_KINDS (sizeof(bench_lines) / sizeof(bench_lines[0]))
+
+// A query found on one line in a file, one found all over, and one found
+// nowhere.
+char *bench_queries[] = { "parse_header_v2", "return", "no such text" };
+
+#define BENCH_QUERIES (sizeof(bench_queries) / sizeof(bench_queries[0]))
+
+/*** bench ***/
+
+double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench_read_key(void) {
+  die("bench/grep reads no keys");
+  return 0;
+}
+
+void bench_write(const char *buffer, int length) {
+  (void)buffer;
+  (void)length;
+}
+
+int bench_get_window_size(int *rows, int *cols) {
+  *rows = 50;
+  *cols = 160;
+  return 0;
+}
+
+struct editor_terminal bench_terminal = {
+  bench_read_key,
+  bench_write,
+  bench_get_window_size,
+  NULL
+};
+
+// Writes BENCH_DIRS directories of BENCH_FILES files under root, and
+// returns how many bytes they hold.
+long bench_generate_tree(char *root) {
+  long bytes = 0;
+  char path[PATH_MAX];
+  int d;
+  for (d = 0; d < BENCH_DIRS; d++) {
+    snprintf(path, sizeof(path), "%s/d%d", root, d);
+    if (mkdir(path, 0700) == -1) {
+      die("mkdir");
+    }
+    int f;
+    for (f = 0; f < BENCH_FILES; f++) {
+      snprintf(path, sizeof(path), "%s/d%d/f%d.c", root, d, f);
+      FILE *fp = fopen(path, "w");
+      if (fp == NULL) {
+        die("fopen");
+      }
+      int j;
+      for (j = 0; j < BENCH_FILE_LINES; j++) {
+        fprintf(fp, "%s\n", bench_lines[j % BENCH_LINE_KINDS]);
+      }
+      fprintf(fp, "int parse_header_v2(void);\n");
+      bytes += ftell(fp);
+      fclose(fp);
+    }
+  }
+  return bytes;
+}
+
+void bench_remove_tree(char *root) {
+  char path[PATH_MAX];
+  int d;
+  for (d = 0; d < BENCH_DIRS; d++) {
+    int f;
+    for (f = 0; f < BENCH_FILES; f++) {
+      snprintf(path, sizeof(path), "%s/d%d/f%d.c", root, d, f);
+      unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/d%d", root, d);
+    rmdir(path);
+  }
+  rmdir(root);
+}
+
+// Best of BENCH_RUNS, since the first run also pays for reading the files
+// into the page cache. Results are taken in as the editor would between
+// keys.
+double bench_grep(char *query, int *matches) {
+  double best = 0;
+  int run;
+  for (run = 0; run < BENCH_RUNS; run++) {
+    double start = bench_now();
+    editor_grep_start(".", query);
+    while (!E.grep->finished) {
+      editor_grep_absorb();
+      usleep(1000);
+    }
+    double elapsed = bench_now() - start;
+    *matches = E.num_rows;
+    editor_close();
+    if (run == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+int main(void) {
+  init_editor(&bench_terminal);
+
+  char root[] = "/tmp/kilo-grep-XXXXXX";
+  if (mkdtemp(root) == NULL) {
+    die("mkdtemp");
+  }
+  long bytes = bench_generate_tree(root);
+  double mb = bytes / (1024.0 * 1024.0);
+  int files = BENCH_DIRS * BENCH_FILES;
+  if (chdir(root) == -1) {
+    die("chdir");
+  }
+  printf(
+    "project search with %d threads, %d files, %.1f MB\n",
+    editor_thread_count(),
+    files,
+    mb);
+
+  unsigned int j;
+  for (j = 0; j < BENCH_QUERIES; j++) {
+    int matches;
+    double elapsed = bench_grep(bench_queries[j], &matches);
+    printf(
+      "  %-16s %8d matches   %7.1f MB/s   %8.0f files/s\n",
+      bench_queries[j],
+      matches,
+      mb / elapsed,
+      files / elapsed);
+  }
+
+  if (chdir("/") == -1) {
+    die("chdir");
+  }
+  bench_remove_tree(root);
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*** includes ***/
+
+#include "../kilo.h"
+
+/*** defines ***/
+
+#define BENCH_RUNS 3
+
+/*** data ***/
+
+char *bench_lines[] = {
+  "static int parse_header(struct header *h, const char *buf, int len) {",
+  "  for (int i = 0; i < len; i++) { if (buf[i] == '\\n') return i + 1; }",
+  "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+  "  double ratio = (double)h->count / 3.14159 + 2.71828 * h->scale;",
+  "\twhile (h->next != NULL && h->flags & 0x10) { h = h->next; }",
+  "  char *msg = \"unexpected token in header, expected ':' or ';'\";",
+  "",
+  "}",
+};
+
+#define BENCH_LINE_KINDS (sizeof(bench_lines) / sizeof(bench_lines[0]))
+
+int bench_default_sizes[] = { 100000, 1000000, 4000000 };
+
+#define BENCH_DEFAULT_SIZES \
+  (sizeof(bench_default_sizes) / sizeof(bench_default_sizes[0]))
+
+/*** bench ***/
+
+double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int bench_read_key(void) {
+  die("bench/load reads no keys");
+  return 0;
+}
+
+void bench_write(const char *buffer, int length) {
+  (void)buffer;
+  (void)length;
+}
+
+int bench_get_window_size(int *rows, int *cols) {
+  *rows = 50;
+  *cols = 160;
+  return 0;
+}
+
+struct editor_terminal bench_terminal = {
+  bench_read_key,
+  bench_write,
+  bench_get_window_size,
+  NULL
+};
+
+// Writes the same lines under a name without a known extension and under a
+// .c name, so loading can be timed with and without highlighting.
+long bench_generate_file(int lines, char *plain, char *source) {
+  int fd = mkstemp(plain);
+  if (fd == -1) {
+    die("mkstemp");
+  }
+  FILE *fp = fdopen(fd, "w");
+  if (fp == NULL) {
+    die("fdopen");
+  }
+  int j;
+  for (j = 0; j < lines; j++) {
+    fprintf(fp, "%s\n", bench_lines[j % BENCH_LINE_KINDS]);
+  }
+  long bytes = ftell(fp);
+  fclose(fp);
+
+  snprintf(source, 64, "%s.c", plain);
+  if (link(plain, source) == -1) {
+    die("link");
+  }
+  return bytes;
+}
+
+// Best of BENCH_RUNS, since the first run also pays for reading the file
+// into the page cache.
+double bench_load(char *filename) {
+  double best = 0;
+  int run;
+  for (run = 0; run < BENCH_RUNS; run++) {
+    double start = bench_now();
+    editor_open(filename);
+    editor_wait_rows(INT_MAX);
+    double elapsed = bench_now() - start;
+    editor_close();
+    if (run == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+void bench_size(int lines) {
+  char plain[64] = "/tmp/kilo-load-XXXXXX";
+  char source[64];
+  long bytes = bench_generate_file(lines, plain, source);
+  double mb = bytes / (1024.0 * 1024.0);
+
+  double split = bench_load(plain);
+  double highlight = bench_load(source);
+  printf(
+    "%8d lines %7.1f MB   split %7.1f MB/s   split+highlight %7.1f MB/s\n",
+    lines,
+    mb,
+    mb / split,
+    mb / highlight);
+
+  unlink(plain);
+  unlink(source);
+}
+
+int main(int argc, char *argv[]) {
+  init_editor(&bench_terminal);
+  printf("editor_open with %d threads\n", editor_thread_count());
+
+  if (argc > 1) {
+    int j;
+    for (j = 1; j < argc; j++) {
+      bench_size(atoi(argv[j]));
+    }
+  } else {
+    unsigned int j;
+    for (j = 0; j < BENCH_DEFAULT_SIZES; j++) {
+      bench_size(bench_default_sizes[j]);
+    }
+  }
+  return 0;
+}
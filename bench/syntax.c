@@ -0,0 +1,198 @@
+/*** includes ***/
+
+#include "../kilo.h"
+
+/*** defines ***/
+
+#define BENCH_COMPILES 2000
+#define BENCH_BYTES (64 << 20)
+
+/*** data ***/
+
+// Definitions in the format of ~/.kilo-syntax, next to the built-in C one.
+char *bench_config =
+  "[python]\n"
+  "match = .py\n"
+  "keywords = def class if elif else while for in return import from as\n"
+  "keywords = with try except finally raise pass break continue lambda\n"
+  "keywords = yield global nonlocal assert del not and or is async await\n"
+  "types = int str float bool list dict set tuple bytes object None True\n"
+  "types = False self\n"
+  "comment = #\n"
+  "strings = \" '\n"
+  "numbers = yes\n"
+  "number_chars = .xXabcdefABCDEF_\n"
+  "\n"
+  "[javascript]\n"
+  "match = .js\n"
+  "keywords = function var let const if else for while do return switch\n"
+  "keywords = case break continue new delete typeof instanceof in of try\n"
+  "keywords = catch finally throw class extends super import export from\n"
+  "keywords = default async await yield this\n"
+  "types = null undefined true false NaN Infinity Object Array String\n"
+  "types = Number Boolean Promise Map Set\n"
+  "comment = //\n"
+  "block_comment = /* */\n"
+  "strings = \" ' `\n"
+  "numbers = yes\n"
+  "\n"
+  "[lua]\n"
+  "match = .lua\n"
+  "keywords = and break do else elseif end for function goto if in local\n"
+  "keywords = not or repeat return then until while\n"
+  "types = nil true false self\n"
+  "comment = --\n"
+  "block_comment = --[[ ]]\n"
+  "strings = \" '\n"
+  "numbers = yes\n"
+  "\n"
+  "[sql]\n"
+  "match = .sql\n"
+  "keywords = SELECT FROM WHERE AND OR NOT INSERT INTO VALUES UPDATE SET\n"
+  "keywords = DELETE CREATE TABLE INDEX ON JOIN LEFT RIGHT INNER OUTER\n"
+  "keywords = GROUP BY ORDER HAVING LIMIT AS DISTINCT UNION NULL IS IN\n"
+  "types = INT INTEGER BIGINT TEXT VARCHAR CHAR BOOLEAN DATE TIMESTAMP\n"
+  "comment = --\n"
+  "block_comment = /* */\n"
+  "strings = '\n"
+  "numbers = yes\n";
+
+struct bench_language {
+  char *file_type;
+  char *lines[6];
+};
+
+struct bench_language bench_languages[] = {
+  {"c", {
+    "static int parse_header(struct header *h, const char *buf, int len) {",
+    "  for (int i = 0; i < len; i++) { if (buf[i] == '\\n') return i + 1; }",
+    "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+    "  double ratio = (double)h->count / 3.14159 + 2.71828 * h->scale;",
+    "  char *msg = \"unexpected token in header, expected ':' or ';'\";",
+    "  // TODO: unsigned long offsets break on files larger than 4 GB",
+  }},
+  {"python", {
+    "def parse_header(self, buf: bytes, length: int) -> dict:",
+    "    for i in range(length):  # stop at the first newline",
+    "        if buf[i] == 0x0a and not self.strict: return {'end': i + 1}",
+    "    ratio = float(self.count) / 3.14159 + 2.71828 * self.scale",
+    "    raise ValueError(\"unexpected token in header, expected ':'\")",
+    "    return None if self.next is None else self.next.parse(buf, 0)",
+  }},
+  {"javascript", {
+    "export async function parseHeader(buf, len) { const out = new Map();",
+    "  for (let i = 0; i < len; i++) { if (buf[i] === 10) return i + 1; }",
+    "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+    "  const ratio = this.count / 3.14159 + 2.71828 * this.scale;",
+    "  throw new Error(`unexpected token in header, expected ':' or ';'`);",
+    "  // TODO: offsets break on files larger than 4 GB, see issue 1234",
+  }},
+  {"lua", {
+    "local function parse_header(h, buf, len)",
+    "  for i = 1, len do if buf:byte(i) == 10 then return i + 1 end end",
+    "  --[[ 0x7f marks the end of a block, see section 4.2 of the spec ]]",
+    "  local ratio = h.count / 3.14159 + 2.71828 * h.scale",
+    "  error(\"unexpected token in header, expected ':' or ';'\")",
+    "  -- TODO: offsets break on files larger than 4 GB",
+  }},
+  {"sql", {
+    "SELECT h.id, h.count / 3.14159 AS ratio FROM headers AS h",
+    "  LEFT JOIN blocks AS b ON b.header_id = h.id AND b.flags = 16",
+    "  /* 0x7f marks the end of a block, see section 4.2 of the spec */",
+    "WHERE h.name <> 'unexpected token' AND h.size > 4294967296",
+    "GROUP BY h.id HAVING COUNT(b.id) > 42 ORDER BY ratio LIMIT 100;",
+    "-- TODO: offsets break on tables larger than 4 GB",
+  }},
+};
+
+#define BENCH_LANGUAGES \
+  (sizeof(bench_languages) / sizeof(bench_languages[0]))
+
+/*** bench ***/
+
+double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct editor_syntax *bench_find_syntax(char *file_type) {
+  int j;
+  for (j = 0; j < editor_num_loaded_syntax; j++) {
+    if (!strcmp(editor_loaded_syntax[j]->file_type, file_type)) {
+      return editor_loaded_syntax[j];
+    }
+  }
+  return &HLDB[0];
+}
+
+void bench_language(struct bench_language *language) {
+  struct editor_syntax *syntax = bench_find_syntax(language->file_type);
+
+  double start = bench_now();
+  int j;
+  for (j = 0; j < BENCH_COMPILES; j++) {
+    editor_lexer_free(syntax->lexer);
+    syntax->lexer = editor_syntax_compile(syntax);
+  }
+  double compile = (bench_now() - start) / BENCH_COMPILES;
+  E.syntax = syntax;
+
+  // Rows are highlighted one at a time, as editor_highlight_row does, with
+  // the comment state carried from each row to the next.
+  int lines = sizeof(language->lines) / sizeof(language->lines[0]);
+  int lengths[6];
+  int longest = 0;
+  for (j = 0; j < lines; j++) {
+    lengths[j] = strlen(language->lines[j]);
+    if (lengths[j] > longest) {
+      longest = lengths[j];
+    }
+  }
+  unsigned char *hl = malloc(longest);
+  long bytes = 0;
+  int in_comment = 0;
+  start = bench_now();
+  for (j = 0; bytes < BENCH_BYTES; j++) {
+    char *line = language->lines[j % lines];
+    int len = lengths[j % lines];
+    struct editor_highlight_state state = {in_comment, 0, 1, 0, 0};
+    memset(hl, HL_NORMAL, len);
+    editor_highlight_scan(syntax, line, len, 0, len, &state, hl);
+    in_comment = state.in_comment;
+    bytes += len;
+  }
+  double elapsed = bench_now() - start;
+  free(hl);
+
+  printf(
+    "%-10s %4d states x %3d columns   compile %7.2f us   "
+    "highlight %7.1f MB/s\n",
+    syntax->file_type,
+    syntax->lexer->num_states,
+    syntax->lexer->num_columns,
+    compile * 1e6,
+    bytes / elapsed / 1e6);
+}
+
+int main(void) {
+  char path[] = "/tmp/kilo-syntax-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd == -1) {
+    die("mkstemp");
+  }
+  if (write(fd, bench_config, strlen(bench_config)) == -1) {
+    die("write");
+  }
+  close(fd);
+  if (editor_syntax_load(path) == -1) {
+    die("editor_syntax_load");
+  }
+  unlink(path);
+
+  unsigned int j;
+  for (j = 0; j < BENCH_LANGUAGES; j++) {
+    bench_language(&bench_languages[j]);
+  }
+  return 0;
+}
@@ -0,0 +1,1028 @@
+#include "kilo.h"
+
+/*** arena ***/
+
+char *editor_arena_alloc(struct editor_arena_chunk **arena, size_t size) {
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  struct editor_arena_chunk *chunk = *arena;
+  if (chunk == NULL || chunk->size - chunk->used < size) {
+    size_t chunk_size = size > KILO_ARENA_CHUNK ? size : KILO_ARENA_CHUNK;
+    chunk = malloc(sizeof(struct editor_arena_chunk) + chunk_size);
+    if (chunk == NULL) {
+      die("malloc");
+    }
+    chunk->used = 0;
+    chunk->size = chunk_size;
+    chunk->next = *arena;
+    *arena = chunk;
+  }
+
+  char *p = &chunk->data[chunk->used];
+  chunk->used += size;
+  return p;
+}
+
+// Moves the chunks of an arena filled by another thread over to arena.
+void editor_arena_adopt(
+  struct editor_arena_chunk **arena,
+  struct editor_arena_chunk *chunk) {
+  while (chunk) {
+    struct editor_arena_chunk *next = chunk->next;
+    chunk->next = *arena;
+    *arena = chunk;
+    chunk = next;
+  }
+}
+
+void editor_arena_free(struct editor_arena_chunk **arena) {
+  while (*arena) {
+    struct editor_arena_chunk *next = (*arena)->next;
+    free(*arena);
+    *arena = next;
+  }
+}
+
+/*** row operations ***/
+
+void editor_row_bind(editor_row *row) {
+  char *base = row->block ? row->block : row->inline_data;
+  row->chars = row->chunks ? NULL : base;
+  row->render = (row->num_tabs || row->chunks) ?
+    row->render_buffer : row->chars;
+}
+
+// Returns row at, with its render and highlight rebuilt if the cache
+// evicted them, and for a long row rendered for the columns on screen. In a
+// read-only view the row is decoded from disk on demand, so the pointer is
+// only good until the next row is fetched.
+editor_row *editor_row_at(int at) {
+  if (E.view) {
+    return editor_view_row(at);
+  }
+  editor_row *row = &E.row[at];
+  row->last_use = E.cache_clock;
+  editor_row_restore(row);
+  if (row->chunks) {
+    editor_chunks_window(row);
+  }
+  return row;
+}
+
+int editor_grow_capacity(int capacity, int needed) {
+  if (capacity == 0) {
+    return needed;
+  }
+  if (capacity < 16) {
+    capacity = 16;
+  }
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+// Makes room for at least capacity bytes of chars, keeping their contents.
+// The first reservation is exact, later ones grow geometrically so that
+// typing into a row only reallocates occasionally.
+void editor_row_reserve(editor_row *row, int capacity) {
+  if (capacity <= row->capacity) {
+    return;
+  }
+
+  int new_capacity = editor_grow_capacity(row->capacity, capacity);
+  char *block = NULL;
+  if (new_capacity > KILO_ROW_INLINE) {
+    block = malloc(new_capacity);
+    if (block == NULL) {
+      die("malloc");
+    }
+    memcpy(block, row->chars, row->capacity);
+  }
+
+  if (!row->in_arena) {
+    free(row->block);
+  }
+  row->in_arena = 0;
+  row->block = block;
+  row->capacity = new_capacity;
+  editor_row_bind(row);
+}
+
+// Each tab stop records the column of a tab in chars and the render column
+// just past its expansion. Between two tabs both columns advance in lockstep,
+// so a binary search over the stops is enough to convert in either direction.
+
+int editor_row_cursor_x_to_render_x(editor_row *row, int cursor_x) {
+  if (row->chunks) {
+    return editor_chunks_cursor_x_to_render_x(row, cursor_x);
+  }
+  int lo = 0;
+  int hi = row->num_tabs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (row->tab_stops[mid].cursor_x < cursor_x) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo == 0) {
+    return cursor_x;
+  }
+
+  struct editor_tab_stop *stop = &row->tab_stops[lo - 1];
+  return stop->render_x + (cursor_x - stop->cursor_x - 1);
+}
+
+int eidtor_row_render_x_to_cursor_x(editor_row *row, int render_x) {
+  if (row->chunks) {
+    return editor_chunks_render_x_to_cursor_x(row, render_x);
+  }
+  int lo = 0;
+  int hi = row->num_tabs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (row->tab_stops[mid].render_x <= render_x) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  int cursor_x = render_x;
+  if (lo > 0) {
+    struct editor_tab_stop *stop = &row->tab_stops[lo - 1];
+    cursor_x = stop->cursor_x + 1 + (render_x - stop->render_x);
+  }
+
+  if (lo < row->num_tabs && cursor_x >= row->tab_stops[lo].cursor_x) {
+    return row->tab_stops[lo].cursor_x;
+  }
+  if (cursor_x > row->size) {
+    cursor_x = row->size;
+  }
+
+  return cursor_x;
+}
+
+// Rebuilds the row's render, tab stops and glyph runs from its chars. A row
+// past KILO_CHUNK_ROW moves to chunks here, and only has its columns laid
+// out.
+void editor_row_render(editor_row *row) {
+  if (row->chunks == NULL && row->size > KILO_CHUNK_ROW) {
+    editor_row_chunk(row);
+  }
+  if (row->chunks) {
+    editor_chunks_render(row);
+    return;
+  }
+  row->render_start = 0;
+
+  int tabs = 0;
+  int j;
+  for (j = 0; j < row->size; j++) {
+    if (row->chars[j] == '\t') {
+      tabs++;
+    }
+  }
+
+  // Without tabs the render is byte-for-byte identical to chars, so the row
+  // shares that buffer instead of keeping a copy.
+  row->num_tabs = tabs;
+  if (tabs == 0) {
+    row->render = row->chars;
+    row->render_size = row->size;
+    editor_row_measure(row);
+    return;
+  }
+
+  int render_needed = row->size + tabs*(KILO_TAB_STOP - 1) + 1;
+  if (render_needed > row->render_capacity) {
+    row->render_capacity = editor_grow_capacity(
+      row->render_capacity,
+      render_needed);
+    free(row->render_buffer);
+    row->render_buffer = malloc(row->render_capacity);
+  }
+  if (tabs > row->tab_capacity) {
+    row->tab_capacity = editor_grow_capacity(row->tab_capacity, tabs);
+    free(row->tab_stops);
+    row->tab_stops = malloc(sizeof(struct editor_tab_stop) * row->tab_capacity);
+  }
+  row->render = row->render_buffer;
+
+  int idx = 0;
+  tabs = 0;
+  for (j = 0; j < row->size; j++) {
+    if (row->chars[j] == '\t') {
+      row->render[idx++] = ' ';
+      while (idx % KILO_TAB_STOP != 0) {
+        row->render[idx++] = ' ';
+      }
+      row->tab_stops[tabs].cursor_x = j;
+      row->tab_stops[tabs].render_x = idx;
+      tabs++;
+    } else {
+      row->render[idx++] = row->chars[j];
+    }
+  }
+  row->render[idx] = '\0';
+  row->render_size = idx;
+  editor_row_measure(row);
+}
+
+void editor_update_row(editor_row *row) {
+  size_t bytes = editor_row_cache_bytes(row);
+  editor_row_render(row);
+  row->evicted = 0;
+  E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+  editor_wrap_update(row);
+
+  // Rows read by editor_open are highlighted together once the whole file
+  // is in, so the work can be spread over several threads.
+  if (!E.loading) {
+    editor_update_syntax(row);
+  }
+}
+
+void editor_row_init(editor_row *row, int at) {
+  row->idx = at;
+  row->size = 0;
+  row->render_size = 0;
+  row->capacity = 0;
+  row->num_hl = 0;
+  row->hl_capacity = 0;
+  row->hl_in_arena = 0;
+  row->hl = NULL;
+  row->hl_open_comment = 0;
+  row->num_tabs = 0;
+  row->tab_capacity = 0;
+  row->tab_stops = NULL;
+  row->render_capacity = 0;
+  row->render_buffer = NULL;
+  row->block = NULL;
+  row->in_arena = 0;
+  row->evicted = 0;
+  row->last_use = 0;
+  row->render_start = 0;
+  row->chunks = NULL;
+  row->num_glyph_runs = 0;
+  row->glyph_capacity = 0;
+  row->glyph_runs = NULL;
+  editor_row_bind(row);
+}
+
+void editor_row_table_insert(int at, editor_row *row) {
+  int j;
+  if (E.num_rows == E.row_capacity) {
+    E.row_capacity = E.row_capacity ? E.row_capacity * 2 : 64;
+    E.row = realloc(E.row, sizeof(editor_row) * E.row_capacity);
+    if (E.row == NULL) {
+      die("realloc");
+    }
+    for (j = 0; j < at; j++) {
+      editor_row_bind(&E.row[j]);
+    }
+  }
+  editor_macro_shift(at, 1);
+  editor_panes_shift(at, 1);
+  editor_wrap_shift(at, 1);
+  memmove(&E.row[at + 1], &E.row[at], sizeof(editor_row) * (E.num_rows - at));
+  for (j = at + 1; j <= E.num_rows; j++) {
+    E.row[j].idx++;
+    editor_row_bind(&E.row[j]);
+  }
+
+  E.row[at] = *row;
+  editor_row_bind(&E.row[at]);
+  editor_update_row(&E.row[at]);
+
+  E.num_rows++;
+}
+
+void editor_insert_row(int at, char *s, size_t len) {
+  if (at < 0 || at > E.num_rows) {
+    return;
+  }
+
+  // s may point into a row of E.row, so copy it out before E.row can move.
+  editor_row row;
+  editor_row_init(&row, at);
+  editor_row_reserve(&row, len + 1);
+  memcpy(row.chars, s, len);
+  row.chars[len] = '\0';
+  row.size = len;
+
+  editor_row_table_insert(at, &row);
+  E.dirty++;
+}
+
+// Fills row with a line read from disk. Its block is sized exactly and taken
+// from arena unless it fits inline, so loading a file costs no per-row
+// allocations. A long line goes straight into chunks.
+void editor_row_load(
+  editor_row *row,
+  int at,
+  const char *s,
+  size_t len,
+  struct editor_arena_chunk **arena) {
+  editor_row_init(row, at);
+  if (len > KILO_CHUNK_ROW) {
+    editor_chunks_make(row, s, len);
+    editor_row_bind(row);
+    return;
+  }
+  row->capacity = len + 1;
+  if (row->capacity > KILO_ROW_INLINE) {
+    row->block = editor_arena_alloc(arena, row->capacity);
+    row->in_arena = 1;
+  }
+  editor_row_bind(row);
+  memcpy(row->chars, s, len);
+  row->chars[len] = '\0';
+  row->size = len;
+}
+
+void editor_load_row(char *s, size_t len) {
+  editor_row row;
+  editor_row_load(&row, E.num_rows, s, len, &E.arena);
+  editor_row_table_insert(E.num_rows, &row);
+}
+
+void editor_free_row(editor_row *row) {
+  if (row->chunks) {
+    editor_chunks_free(row);
+  }
+  if (!row->in_arena) {
+    free(row->block);
+  }
+  if (!row->hl_in_arena) {
+    free(row->hl);
+  }
+  free(row->render_buffer);
+  free(row->tab_stops);
+  free(row->glyph_runs);
+}
+
+void editor_del_row(int at) {
+  if (at < 0 || at >= E.num_rows) {
+    return;
+  }
+
+  E.cache_bytes -= editor_row_cache_bytes(&E.row[at]);
+  editor_free_row(&E.row[at]);
+  editor_macro_shift(at, -1);
+  editor_panes_shift(at, -1);
+  editor_wrap_shift(at, -1);
+  memmove(
+    &E.row[at],
+    &E.row[at + 1],
+    sizeof(editor_row) * (E.num_rows - at - 1));
+  for (int j = at; j < E.num_rows - 1; j++) {
+    E.row[j].idx--;
+    editor_row_bind(&E.row[j]);
+  }
+  E.num_rows--;
+  E.dirty++;
+}
+
+void editor_row_insert_char(editor_row *row, int at, int c) {
+  if (at < 0 || at > row->size) {
+    at = row->size;
+  }
+  if (row->chunks) {
+    char ch = c;
+    editor_chunks_insert(row, at, &ch, 1);
+    editor_update_row(row);
+    E.dirty++;
+    return;
+  }
+  editor_row_reserve(row, row->size + 2);
+  memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
+  row->size++;
+  row->chars[at] = c;
+  editor_update_row(row);
+  E.dirty++;
+}
+
+void editor_row_append_string(editor_row *row, char *s, size_t len) {
+  if (row->chunks) {
+    editor_chunks_insert(row, row->size, s, len);
+    editor_update_row(row);
+    E.dirty++;
+    return;
+  }
+  editor_row_reserve(row, row->size + len + 1);
+  memcpy(&row->chars[row->size], s, len);
+  row->size += len;
+  row->chars[row->size] = '\0';
+  editor_update_row(row);
+  E.dirty++;
+}
+
+void editor_row_del_char(editor_row *row, int at) {
+  if (at < 0 || at >= row->size) {
+    return;
+  }
+  if (row->chunks) {
+    editor_chunks_delete(row, at);
+  } else {
+    memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
+    row->size--;
+  }
+  editor_update_row(row);
+  E.dirty++;
+}
+
+/*** editor operations ***/
+
+int editor_read_only(void) {
+  if (E.view) {
+    editor_set_status_message("File is opened read-only");
+    return 1;
+  }
+  if (E.grep) {
+    editor_set_status_message("Search results are read-only");
+    return 1;
+  }
+  return 0;
+}
+
+void editor_insert_char(int c) {
+  if (editor_read_only()) {
+    return;
+  }
+  editor_undo_clear();
+  editor_wait_rows(E.cursor_y + 1);
+  if (E.cursor_y == E.num_rows) {
+    editor_insert_row(E.num_rows, "", 0);
+  }
+  editor_row_insert_char(&E.row[E.cursor_y], E.cursor_x, c);
+  E.cursor_x++;
+}
+
+void editor_insert_newline(void) {
+  if (editor_read_only()) {
+    return;
+  }
+  editor_undo_clear();
+  editor_wait_rows(E.cursor_y + 1);
+  if (E.cursor_x == 0) {
+    editor_insert_row(E.cursor_y, "", 0);
+  } else {
+    editor_row *row = &E.row[E.cursor_y];
+    if (row->chunks) {
+      editor_row_flatten(row);
+    }
+    editor_insert_row(
+      E.cursor_y + 1,
+      &row->chars[E.cursor_x],
+      row->size - E.cursor_x);
+    row = &E.row[E.cursor_y];
+    row->size = E.cursor_x;
+    row->chars[row->size] = '\0';
+    editor_update_row(row);
+  }
+  E.cursor_y++;
+  E.cursor_x = 0;
+}
+
+void editor_del_char(void) {
+  if (editor_read_only()) {
+    return;
+  }
+  editor_undo_clear();
+  editor_wait_rows(E.cursor_y + 1);
+  if (E.cursor_y == E.num_rows) {
+    return;
+  }
+  if (E.cursor_x == 0 && E.cursor_y == 0) {
+    return;
+  }
+
+  editor_row *row = &E.row[E.cursor_y];
+  if (E.cursor_x > 0) {
+    int from = editor_row_prev_char(row, E.cursor_x);
+    while (E.cursor_x > from) {
+      editor_row_del_char(row, E.cursor_x - 1);
+      E.cursor_x--;
+    }
+  } else {
+    E.cursor_x = E.row[E.cursor_y - 1].size;
+    if (row->chunks) {
+      editor_row_flatten(row);
+    }
+    editor_row_append_string(&E.row[E.cursor_y - 1], row->chars, row->size);
+    editor_del_row(E.cursor_y);
+    E.cursor_y--;
+  }
+}
+
+/*** file i/o ***/
+
+char *editor_rows_to_string(int *buffer_length) {
+  editor_wait_rows(INT_MAX);
+
+  int total_length = 0;
+  int j;
+  for (j = 0; j < E.num_rows; j++) {
+    total_length += E.row[j].size + 1;
+  }
+  *buffer_length = total_length;
+
+  char *buffer = malloc(total_length);
+  char *p = buffer;
+  for (j = 0; j < E.num_rows; j++) {
+    if (E.row[j].chunks) {
+      editor_chunks_gather(E.row[j].chunks, 0, p, E.row[j].size);
+    } else {
+      memcpy(p, E.row[j].chars, E.row[j].size);
+    }
+    p += E.row[j].size;
+    *p = '\n';
+    p++;
+  }
+
+  return buffer;
+}
+
+void editor_open(char *filename) {
+  TRACE_SCOPE("editor_open");
+  free(E.filename);
+  E.filename = strdup(filename);
+
+  editor_select_syntax_highlight();
+
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd == -1 || fstat(fd, &st) == -1) {
+    die("open");
+  }
+
+  E.loading = 1;
+  char *data = NULL;
+  size_t size = 0;
+  size_t prefix = 0;
+  if (S_ISREG(st.st_mode)) {
+    if (st.st_size > 0) {
+      size = st.st_size;
+      E.file_size = size;
+      data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        die("mmap");
+      }
+      madvise(data, size, MADV_SEQUENTIAL);
+      prefix = editor_index_prefix(data, size);
+      editor_load_buffer(data, prefix);
+    }
+    close(fd);
+  } else {
+    // Pipes and devices cannot be mapped, so they are read line by line.
+    FILE *fp = fdopen(fd, "r");
+    if (!fp) {
+      die("fdopen");
+    }
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t line_len;
+    while ((line_len = getline(&line, &line_cap, fp)) != -1) {
+      while (line_len > 0 && (line[line_len - 1] == '\n' ||
+                              line[line_len - 1] == '\r')) {
+        line_len --;
+      }
+      editor_load_row(line, line_len);
+    }
+    free(line);
+    fclose(fp);
+  }
+  editor_highlight_rows();
+  E.loading = 0;
+  E.dirty = 0;
+
+  // The rest of a large file is indexed in the background, so the first
+  // screen can be painted right away.
+  if (prefix < size) {
+    editor_index_start(data, size, prefix);
+  } else if (data) {
+    munmap(data, size);
+  }
+}
+
+void editor_close(void) {
+  editor_panes_free();
+  editor_wrap_free();
+  editor_grep_cancel();
+  editor_index_cancel();
+  editor_view_close();
+  editor_follow_stop();
+  editor_undo_clear();
+
+  int j;
+  for (j = 0; j < E.num_rows; j++) {
+    editor_free_row(&E.row[j]);
+  }
+  free(E.row);
+  editor_arena_free(&E.arena);
+  editor_arena_free(&E.hl_arena);
+  free(E.filename);
+
+  E.row = NULL;
+  E.num_rows = 0;
+  E.row_capacity = 0;
+  E.cache_bytes = 0;
+  E.filename = NULL;
+  E.syntax = NULL;
+  E.dirty = 0;
+  E.file_size = 0;
+  E.cursor_x = 0;
+  E.cursor_y = 0;
+  E.render_x = 0;
+  E.row_offset = 0;
+  E.col_offset = 0;
+}
+
+void editor_save(void) {
+  TRACE_SCOPE("editor_save");
+  if (editor_read_only()) {
+    return;
+  }
+  if (E.filename == NULL) {
+    E.filename = editor_prompt("Save as: %s (ESC to cancel)", NULL);
+    if (E.filename == NULL) {
+      editor_set_status_message("Save aborted");
+      return;
+    }
+    editor_select_syntax_highlight();
+  }
+
+  int length;
+  char *buffer = editor_rows_to_string(&length);
+
+  int fd = open(E.filename, O_RDWR | O_CREAT, 0644);
+  if (fd != -1) {
+    if (ftruncate(fd, length) != -1) {
+      if (write(fd, buffer, length) == length) {
+        close(fd);
+        free(buffer);
+        E.dirty = 0;
+        editor_follow_saved(length);
+        editor_set_status_message("%d bytes written to disk", length);
+        return;
+      }
+    }
+    close(fd);
+  }
+  free(buffer);
+  editor_set_status_message("Can't save! I/O error: %s", strerror(errno));
+}
+
+/*** loading ***/
+
+// A mapped file is split into one byte range per thread, each moved forward
+// to start just past a newline so that no line straddles two ranges. A
+// first pass counts the lines of every range, which tells each range the
+// index of its first row, and a second pass builds the rows straight into
+// their final slots in E.row. Both passes look for newlines sixteen bytes
+// at a time where SSE2 is available.
+
+struct editor_load_job {
+  const char *start;
+  const char *end;
+  editor_row *rows;
+  int first_row;
+  int num_rows;
+  struct editor_arena_chunk *arena;
+  pthread_t thread;
+};
+
+int editor_count_lines(const char *p, const char *end) {
+  const char *start = p;
+  int count = 0;
+#ifdef __SSE2__
+  __m128i newline = _mm_set1_epi8('\n');
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    count += __builtin_popcount(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+  }
+#endif
+  for (; p < end; p++) {
+    count += (*p == '\n');
+  }
+
+  // A last line without a newline is still a line.
+  if (end > start && end[-1] != '\n') {
+    count++;
+  }
+  return count;
+}
+
+void editor_load_line(
+  struct editor_load_job *job,
+  int at,
+  const char *s,
+  const char *end) {
+  while (end > s && end[-1] == '\r') {
+    end--;
+  }
+  editor_row *row = &job->rows[at];
+  editor_row_load(row, at, s, end - s, &job->arena);
+  editor_row_render(row);
+}
+
+void *editor_count_worker(void *arg) {
+  TRACE_SCOPE("editor_count_worker");
+  struct editor_load_job *job = arg;
+  job->num_rows = editor_count_lines(job->start, job->end);
+  return NULL;
+}
+
+void *editor_load_worker(void *arg) {
+  TRACE_SCOPE("editor_load_worker");
+  struct editor_load_job *job = arg;
+  const char *line = job->start;
+  const char *p = job->start;
+  int at = job->first_row;
+#ifdef __SSE2__
+  __m128i newline = _mm_set1_epi8('\n');
+  for (; job->end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+    while (mask) {
+      const char *nl = p + __builtin_ctz(mask);
+      editor_load_line(job, at++, line, nl);
+      line = nl + 1;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; p < job->end; p++) {
+    if (*p == '\n') {
+      editor_load_line(job, at++, line, p);
+      line = p + 1;
+    }
+  }
+  if (line < job->end) {
+    editor_load_line(job, at++, line, job->end);
+  }
+  return NULL;
+}
+
+void editor_run_load_jobs(
+  struct editor_load_job *jobs,
+  int num_jobs,
+  void *(*worker)(void *)) {
+  int j;
+  for (j = 1; j < num_jobs; j++) {
+    if (pthread_create(&jobs[j].thread, NULL, worker, &jobs[j]) != 0) {
+      die("pthread_create");
+    }
+  }
+  worker(&jobs[0]);
+  for (j = 1; j < num_jobs; j++) {
+    pthread_join(jobs[j].thread, NULL);
+  }
+}
+
+// Appends the lines of data to the *num_rows rows of *rows, growing the
+// array to the exact size needed and taking chars from arena. Nothing here
+// touches E, so the background indexer can build rows the same way.
+void editor_split_rows(
+  const char *data,
+  size_t size,
+  editor_row **rows,
+  int *num_rows,
+  int *capacity,
+  struct editor_arena_chunk **arena) {
+  TRACE_SCOPE("editor_split_rows");
+  const char *end = data + size;
+
+  int num_jobs = editor_thread_count();
+  if ((size_t)num_jobs > size / KILO_LOAD_BATCH) {
+    num_jobs = size / KILO_LOAD_BATCH;
+  }
+  if (num_jobs < 1) {
+    num_jobs = 1;
+  }
+
+  struct editor_load_job *jobs =
+    malloc(sizeof(struct editor_load_job) * num_jobs);
+  if (jobs == NULL) {
+    die("malloc");
+  }
+  int j;
+  const char *start = data;
+  for (j = 0; j < num_jobs; j++) {
+    const char *stop = end;
+    if (j < num_jobs - 1) {
+      stop = data + size / num_jobs * (j + 1);
+      if (stop < start) {
+        stop = start;
+      }
+      const char *nl = memchr(stop, '\n', end - stop);
+      stop = nl ? nl + 1 : end;
+    }
+    jobs[j].start = start;
+    jobs[j].end = stop;
+    jobs[j].arena = NULL;
+    start = stop;
+  }
+
+  editor_run_load_jobs(jobs, num_jobs, editor_count_worker);
+
+  int total = *num_rows;
+  for (j = 0; j < num_jobs; j++) {
+    jobs[j].first_row = total;
+    total += jobs[j].num_rows;
+  }
+
+  if (total > *capacity) {
+    editor_row *old = *rows;
+    *capacity = total;
+    *rows = realloc(*rows, sizeof(editor_row) * total);
+    if (*rows == NULL) {
+      die("realloc");
+    }
+    if (*rows != old) {
+      for (j = 0; j < *num_rows; j++) {
+        editor_row_bind(&(*rows)[j]);
+      }
+    }
+  }
+
+  for (j = 0; j < num_jobs; j++) {
+    jobs[j].rows = *rows;
+  }
+  editor_run_load_jobs(jobs, num_jobs, editor_load_worker);
+  *num_rows = total;
+
+  for (j = 0; j < num_jobs; j++) {
+    editor_arena_adopt(arena, jobs[j].arena);
+  }
+  free(jobs);
+}
+
+// Appends the lines of data to the row table.
+void editor_load_buffer(const char *data, size_t size) {
+  editor_split_rows(
+    data,
+    size,
+    &E.row,
+    &E.num_rows,
+    &E.row_capacity,
+    &E.arena);
+}
+
+// Moves rows built elsewhere to the end of the row table, growing it
+// geometrically since batches keep arriving while the file is indexed.
+void editor_append_rows(editor_row *rows, int num_rows) {
+  int j;
+  if (E.num_rows + num_rows > E.row_capacity) {
+    editor_row *old = E.row;
+    while (E.num_rows + num_rows > E.row_capacity) {
+      E.row_capacity = E.row_capacity ? E.row_capacity * 2 : 64;
+    }
+    E.row = realloc(E.row, sizeof(editor_row) * E.row_capacity);
+    if (E.row == NULL) {
+      die("realloc");
+    }
+    if (E.row != old) {
+      for (j = 0; j < E.num_rows; j++) {
+        editor_row_bind(&E.row[j]);
+      }
+    }
+  }
+
+  memcpy(&E.row[E.num_rows], rows, sizeof(editor_row) * num_rows);
+  for (j = 0; j < num_rows; j++) {
+    editor_row *row = &E.row[E.num_rows + j];
+    row->idx = E.num_rows + j;
+    editor_row_bind(row);
+    E.cache_bytes += editor_row_cache_bytes(row);
+  }
+  E.num_rows += num_rows;
+}
+
+/*** find ***/
+
+void editor_find_callback(char *query, int key) {
+  TRACE_SCOPE("editor_find_callback");
+  static int last_match = -1;
+  static int direction = 1;
+
+  static int saved_highlight_line;
+  static unsigned char *saved_highlight = NULL;
+
+  if (saved_highlight) {
+    editor_row *row = &E.row[saved_highlight_line];
+    size_t bytes = editor_row_cache_bytes(row);
+    editor_row_set_highlight(row, saved_highlight);
+    E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+    free(saved_highlight);
+    saved_highlight = NULL;
+  }
+
+  if (key == '\r' || key == '\x1b') {
+    last_match = -1;
+    direction = 1;
+    return;
+  } else if (key == ARROW_RIGHT || key == ARROW_DOWN) {
+    direction = 1;
+  } else if (key == ARROW_LEFT || key == ARROW_UP) {
+    direction = -1;
+  } else {
+    last_match = -1;
+    direction = 1;
+  }
+
+  if (last_match == -1) {
+    direction = 1;
+  }
+
+  int current = last_match;
+  int i;
+  for (i = 0; i < E.num_rows; i++) {
+    current += direction;
+    if (current == -1) {
+      current = E.num_rows - 1;
+    } else if (current == E.num_rows) {
+      current = 0;
+    }
+
+    // A long row only ever renders what is on screen, so its chars are
+    // searched instead, and its match is not highlighted.
+    editor_row *row = &E.row[current];
+    if (row->chunks) {
+      int at = editor_chunks_find(row, query, strlen(query));
+      if (at != -1) {
+        last_match = current;
+        E.cursor_y = current;
+        E.cursor_x = at;
+        E.row_offset = E.num_rows;
+        break;
+      }
+      continue;
+    }
+
+    // An evicted row without tabs renders as its chars, so only rows with
+    // tabs need their render back to be searched. Highlighting waits until
+    // a row matches.
+    if (row->render == NULL) {
+      size_t bytes = editor_row_cache_bytes(row);
+      editor_row_render(row);
+      E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+    }
+    char *match = strstr(row->render, query);
+    if (match) {
+      int at = match - row->render;
+      editor_row_restore(row);
+      last_match = current;
+      E.cursor_y = current;
+      E.cursor_x = eidtor_row_render_x_to_cursor_x(row, at);
+      E.row_offset = E.num_rows;
+
+      saved_highlight_line = current;
+      saved_highlight = malloc(row->render_size);
+      editor_row_get_highlight(row, saved_highlight);
+
+      unsigned char *hl = editor_highlight_scratch(row->render_size);
+      memcpy(hl, saved_highlight, row->render_size);
+      memset(&hl[at], HL_MATCH, strlen(query));
+      size_t bytes = editor_row_cache_bytes(row);
+      editor_row_set_highlight(row, hl);
+      E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+      break;
+    }
+  }
+}
+
+void editor_find(void) {
+  int saved_cursor_x = E.cursor_x;
+  int saved_cursor_y = E.cursor_y;
+  int saved_col_offset = E.col_offset;
+  int saved_row_offset = E.row_offset;
+
+  char *query;
+  if (E.view) {
+    query = editor_prompt(
+      "Search: %s (Use ESC/Arrows/Enter to search)",
+      editor_view_find_callback);
+  } else {
+    // Searches wrap around the file, so they need all of it.
+    editor_wait_rows(INT_MAX);
+    query = editor_prompt(
+      "Search: %s (Use ESC/Arrows/Enter)",
+      editor_find_callback);
+  }
+
+  if (query) {
+    free(query);
+  } else {
+    E.cursor_x = saved_cursor_x;
+    E.cursor_y = saved_cursor_y;
+    E.col_offset = saved_col_offset;
+    E.row_offset = saved_row_offset;
+  }
+}
@@ -0,0 +1,200 @@
+#include "kilo.h"
+
+/*** row cache ***/
+
+// A row's render, tab stops, glyph runs and highlight spans can all be
+// rebuilt from its chars and the comment state it starts in, which stays in
+// the row above as hl_open_comment. Once the bytes they hold pass
+// E.cache_budget, the rows least recently fetched through editor_row_at lose
+// them, and get them back the next time they are fetched. Every refresh
+// ticks E.cache_clock, so rows on screen are never the ones evicted.
+
+size_t editor_row_cache_bytes(editor_row *row) {
+  return row->render_capacity +
+    row->tab_capacity * sizeof(struct editor_tab_stop) +
+    row->hl_capacity * sizeof(struct editor_hl_span) +
+    row->glyph_capacity * sizeof(struct editor_glyph_run);
+}
+
+// A row without tabs keeps rendering as its chars. For the others render is
+// NULL until the row is restored.
+void editor_row_evict(editor_row *row) {
+  E.cache_bytes -= editor_row_cache_bytes(row);
+  if (!row->hl_in_arena) {
+    free(row->hl);
+  }
+  free(row->render_buffer);
+  free(row->tab_stops);
+  free(row->glyph_runs);
+  row->num_hl = 0;
+  row->hl_capacity = 0;
+  row->hl_in_arena = 0;
+  row->hl = NULL;
+  row->tab_capacity = 0;
+  row->tab_stops = NULL;
+  row->num_glyph_runs = 0;
+  row->glyph_capacity = 0;
+  row->glyph_runs = NULL;
+  row->render_capacity = 0;
+  row->render_buffer = NULL;
+  if (row->chunks) {
+    row->chunks->window_valid = 0;
+  }
+  row->evicted = 1;
+  editor_row_bind(row);
+}
+
+void editor_row_restore(editor_row *row) {
+  if (!row->evicted) {
+    return;
+  }
+  TRACE_SCOPE("editor_row_restore");
+  editor_update_row(row);
+}
+
+// Rows built off the main thread are counted in bulk once they have joined
+// the row table.
+void editor_cache_recount(void) {
+  E.cache_bytes = 0;
+  int j;
+  for (j = 0; j < E.num_rows; j++) {
+    E.cache_bytes += editor_row_cache_bytes(&E.row[j]);
+  }
+}
+
+// Spans loaded with the file live in E.hl_arena, where evicting them frees
+// nothing, so the ones still in use are copied to a fresh arena and the old
+// one is freed.
+void editor_cache_compact(void) {
+  TRACE_SCOPE("editor_cache_compact");
+  struct editor_arena_chunk *arena = NULL;
+  int j;
+  for (j = 0; j < E.num_rows; j++) {
+    editor_row *row = &E.row[j];
+    if (!row->hl_in_arena) {
+      continue;
+    }
+    E.cache_bytes -= row->hl_capacity * sizeof(struct editor_hl_span);
+    if (row->num_hl == 0) {
+      row->hl = NULL;
+      row->hl_capacity = 0;
+      row->hl_in_arena = 0;
+      continue;
+    }
+    size_t size = row->num_hl * sizeof(struct editor_hl_span);
+    struct editor_hl_span *hl =
+      (struct editor_hl_span *)editor_arena_alloc(&arena, size);
+    memcpy(hl, row->hl, size);
+    row->hl = hl;
+    row->hl_capacity = row->num_hl;
+    E.cache_bytes += size;
+  }
+  editor_arena_free(&E.hl_arena);
+  E.hl_arena = arena;
+}
+
+struct editor_cache_entry {
+  unsigned int last_use;
+  int row;
+};
+
+int editor_cache_entry_compare(const void *a, const void *b) {
+  const struct editor_cache_entry *x = a;
+  const struct editor_cache_entry *y = b;
+  if (x->last_use != y->last_use) {
+    return x->last_use < y->last_use ? -1 : 1;
+  }
+  return x->row - y->row;
+}
+
+// Evicts rows until the cache is back to three quarters of its budget, so
+// that the next trim is some way off. Rows never fetched since loading are
+// the oldest of all and need no sorting; the rest go oldest first.
+void editor_cache_trim(void) {
+  if (E.view || E.cache_budget == 0 || E.cache_bytes <= E.cache_budget) {
+    return;
+  }
+  TRACE_SCOPE("editor_cache_trim");
+  size_t target = E.cache_budget - E.cache_budget / 4;
+  int compact = 0;
+
+  int j;
+  for (j = 0; j < E.num_rows && E.cache_bytes > target; j++) {
+    editor_row *row = &E.row[j];
+    if (row->last_use == 0 && editor_row_cache_bytes(row) > 0) {
+      compact |= row->hl_in_arena;
+      editor_row_evict(row);
+    }
+  }
+
+  if (E.cache_bytes > target) {
+    struct editor_cache_entry *entries = NULL;
+    int num_entries = 0;
+    int capacity = 0;
+    for (j = 0; j < E.num_rows; j++) {
+      editor_row *row = &E.row[j];
+      if (row->last_use == E.cache_clock ||
+          editor_row_cache_bytes(row) == 0) {
+        continue;
+      }
+      if (num_entries == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        entries = realloc(
+          entries,
+          sizeof(struct editor_cache_entry) * capacity);
+        if (entries == NULL) {
+          die("realloc");
+        }
+      }
+      entries[num_entries].last_use = row->last_use;
+      entries[num_entries].row = j;
+      num_entries++;
+    }
+    qsort(
+      entries,
+      num_entries,
+      sizeof(struct editor_cache_entry),
+      editor_cache_entry_compare);
+    for (j = 0; j < num_entries && E.cache_bytes > target; j++) {
+      editor_row *row = &E.row[entries[j].row];
+      compact |= row->hl_in_arena;
+      editor_row_evict(row);
+    }
+    free(entries);
+  }
+
+  if (compact) {
+    editor_cache_compact();
+  }
+  // Evicted rows leave holes all over the heap, which glibc only hands back
+  // to the system when asked.
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+void editor_cache_usage(void) {
+  size_t bytes = E.cache_bytes;
+  size_t budget = E.cache_budget;
+  int cached = 0;
+  int evicted = 0;
+  int j;
+  if (E.view) {
+    bytes = E.view->cache_bytes;
+    budget = E.view->cache_budget;
+    for (j = 0; j < E.view->num_slots; j++) {
+      cached += E.view->slots[j].line != -1;
+    }
+  } else {
+    for (j = 0; j < E.num_rows; j++) {
+      cached += editor_row_cache_bytes(&E.row[j]) > 0;
+      evicted += E.row[j].evicted;
+    }
+  }
+  editor_set_status_message(
+    "Cache: %.1f of %.1f MB in %d rows, %d rows evicted",
+    bytes / (1024.0 * 1024.0),
+    budget / (1024.0 * 1024.0),
+    cached,
+    evicted);
+}
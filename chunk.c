@@ -0,0 +1,641 @@
+#include "kilo.h"
+
+/*** long rows ***/
+
+// Minified code and one-line data dumps can put megabytes on a single row.
+// Past KILO_CHUNK_ROW bytes a row keeps its chars in chunks of at most
+// KILO_CHUNK_SIZE bytes, so that an edit only moves bytes within one chunk.
+// Every chunk knows the render column it starts at and holds a highlight
+// checkpoint. After an edit, columns are laid out again from the edited
+// chunk until a later one starts at the same tab alignment as before, and
+// checkpoints are taken again until a later one comes out unchanged; past
+// that point nothing else can differ. Only the columns on screen are ever
+// rendered and highlighted, scanning from the last checkpoint before them.
+//
+// The highlighter scans chars here rather than render. The two only differ
+// in tabs, which it treats exactly like the spaces they expand to.
+
+int editor_count_tabs(const char *s, int len) {
+  int tabs = 0;
+  int j;
+  for (j = 0; j < len; j++) {
+    tabs += (s[j] == '\t');
+  }
+  return tabs;
+}
+
+// Adds chunks from to to to both ranges of edited chunks.
+void editor_chunks_touch(struct editor_chunks *chunks, int from, int to) {
+  if (from < chunks->render_from) {
+    chunks->render_from = from;
+  }
+  if (to > chunks->render_to) {
+    chunks->render_to = to;
+  }
+  if (from < chunks->highlight_from) {
+    chunks->highlight_from = from;
+  }
+  if (to > chunks->highlight_to) {
+    chunks->highlight_to = to;
+  }
+  chunks->window_valid = 0;
+}
+
+// Keeps a range of edited chunks on the same chunks once those from at on
+// have moved by delta.
+void editor_chunks_shift(int *from, int *to, int at, int delta, int last) {
+  if (*from > *to) {
+    return;
+  }
+  if (*from >= at) {
+    *from += delta;
+  }
+  if (*to >= at) {
+    *to += delta;
+  }
+  if (*to > last) {
+    *to = last;
+  }
+}
+
+// Opens count zeroed chunks at index at.
+void editor_chunks_open(struct editor_chunks *chunks, int at, int count) {
+  if (chunks->num_chunks + count > chunks->capacity) {
+    chunks->capacity = editor_grow_capacity(
+      chunks->capacity,
+      chunks->num_chunks + count);
+    chunks->chunk = realloc(
+      chunks->chunk,
+      sizeof(struct editor_chunk) * chunks->capacity);
+    if (chunks->chunk == NULL) {
+      die("realloc");
+    }
+  }
+  memmove(
+    &chunks->chunk[at + count],
+    &chunks->chunk[at],
+    sizeof(struct editor_chunk) * (chunks->num_chunks - at));
+  memset(&chunks->chunk[at], 0, sizeof(struct editor_chunk) * count);
+  chunks->num_chunks += count;
+
+  int last = chunks->num_chunks - 1;
+  editor_chunks_shift(&chunks->render_from, &chunks->render_to,
+                      at, count, last);
+  editor_chunks_shift(&chunks->highlight_from, &chunks->highlight_to,
+                      at, count, last);
+}
+
+void editor_chunks_close(struct editor_chunks *chunks, int at) {
+  free(chunks->chunk[at].data);
+  memmove(
+    &chunks->chunk[at],
+    &chunks->chunk[at + 1],
+    sizeof(struct editor_chunk) * (chunks->num_chunks - at - 1));
+  chunks->num_chunks--;
+
+  int last = chunks->num_chunks - 1;
+  editor_chunks_shift(&chunks->render_from, &chunks->render_to,
+                      at + 1, -1, last);
+  editor_chunks_shift(&chunks->highlight_from, &chunks->highlight_to,
+                      at + 1, -1, last);
+}
+
+// Cuts len bytes of s into chunks of at most KILO_CHUNK_FILL bytes, opened
+// at index at, and returns how many it took. Chunks start out with room to
+// spare so that typing into them does not split them right away.
+int editor_chunks_fill(
+  struct editor_chunks *chunks,
+  int at,
+  const char *s,
+  int len) {
+  int pieces = (len + KILO_CHUNK_FILL - 1) / KILO_CHUNK_FILL;
+  if (pieces == 0) {
+    pieces = 1;
+  }
+  editor_chunks_open(chunks, at, pieces);
+
+  int j;
+  for (j = 0; j < pieces; j++) {
+    struct editor_chunk *chunk = &chunks->chunk[at + j];
+    int start = (long)len * j / pieces;
+    int end = (long)len * (j + 1) / pieces;
+    chunk->data = malloc(KILO_CHUNK_SIZE);
+    if (chunk->data == NULL) {
+      die("malloc");
+    }
+    chunk->size = end - start;
+    memcpy(chunk->data, &s[start], chunk->size);
+    chunk->tabs = editor_count_tabs(chunk->data, chunk->size);
+  }
+  editor_chunks_touch(chunks, at, at + pieces - 1);
+  return pieces;
+}
+
+// Gives row, which has no chars of its own yet, the len bytes of s as
+// chunks.
+void editor_chunks_make(editor_row *row, const char *s, int len) {
+  struct editor_chunks *chunks = calloc(1, sizeof(*chunks));
+  if (chunks == NULL) {
+    die("calloc");
+  }
+  chunks->render_from = INT_MAX;
+  chunks->render_to = -1;
+  chunks->highlight_from = INT_MAX;
+  chunks->highlight_to = -1;
+  editor_chunks_fill(chunks, 0, s, len);
+  row->chunks = chunks;
+  row->size = len;
+}
+
+// Moves the chars of a row that has grown past KILO_CHUNK_ROW into chunks.
+void editor_row_chunk(editor_row *row) {
+  TRACE_SCOPE("editor_row_chunk");
+  editor_chunks_make(row, row->chars, row->size);
+  if (!row->in_arena) {
+    free(row->block);
+  }
+  row->block = NULL;
+  row->in_arena = 0;
+  row->capacity = 0;
+  free(row->tab_stops);
+  row->tab_stops = NULL;
+  row->tab_capacity = 0;
+  row->num_tabs = 0;
+  free(row->glyph_runs);
+  row->glyph_runs = NULL;
+  row->glyph_capacity = 0;
+  row->num_glyph_runs = 0;
+  editor_row_bind(row);
+}
+
+void editor_chunks_free(editor_row *row) {
+  struct editor_chunks *chunks = row->chunks;
+  int j;
+  for (j = 0; j < chunks->num_chunks; j++) {
+    free(chunks->chunk[j].data);
+  }
+  free(chunks->chunk);
+  free(chunks);
+  row->chunks = NULL;
+  row->render_start = 0;
+}
+
+// Copies at most max bytes of chars, starting with chunk k, into text and
+// NUL-terminates them. Returns how many bytes were copied.
+int editor_chunks_gather(
+  struct editor_chunks *chunks,
+  int k,
+  char *text,
+  int max) {
+  int len = 0;
+  for (; k < chunks->num_chunks && len < max; k++) {
+    int size = chunks->chunk[k].size;
+    if (size > max - len) {
+      size = max - len;
+    }
+    memcpy(&text[len], chunks->chunk[k].data, size);
+    len += size;
+  }
+  text[len] = '\0';
+  return len;
+}
+
+// Returns all the chars of a long row as one heap string.
+char *editor_chunks_copy(editor_row *row) {
+  char *chars = malloc(row->size + 1);
+  if (chars == NULL) {
+    die("malloc");
+  }
+  editor_chunks_gather(row->chunks, 0, chars, row->size);
+  return chars;
+}
+
+// Returns where query, len bytes long, first occurs among the chars of a
+// long row, or -1. Each chunk is searched with the first len - 1 bytes of
+// the ones after it, so a match running over into the next is still seen.
+int editor_chunks_find(editor_row *row, const char *query, int len) {
+  struct editor_chunks *chunks = row->chunks;
+  if (len == 0) {
+    return 0;
+  }
+  char *text = malloc(KILO_CHUNK_SIZE + len);
+  if (text == NULL) {
+    die("malloc");
+  }
+  int offset = 0;
+  int found = -1;
+  int k;
+  for (k = 0; k < chunks->num_chunks && found == -1; k++) {
+    int size = chunks->chunk[k].size;
+    int text_len = editor_chunks_gather(chunks, k, text, size + len - 1);
+    char *match = memmem(text, text_len, query, len);
+    if (match && match - text < size) {
+      found = offset + (match - text);
+    }
+    offset += size;
+  }
+  free(text);
+  return found;
+}
+
+// Turns a long row back into a flat one, for the edits that need all of its
+// chars in one place. Its render is stale until it is next rendered.
+void editor_row_flatten(editor_row *row) {
+  TRACE_SCOPE("editor_row_flatten");
+  char *chars = editor_chunks_copy(row);
+  editor_chunks_free(row);
+  row->in_arena = 0;
+  if (row->size + 1 > KILO_ROW_INLINE) {
+    row->block = chars;
+    row->capacity = row->size + 1;
+    editor_row_bind(row);
+  } else {
+    row->block = NULL;
+    row->capacity = KILO_ROW_INLINE;
+    editor_row_bind(row);
+    memcpy(row->chars, chars, row->size + 1);
+    free(chars);
+  }
+}
+
+// Returns the chunk holding char at, and its offset in that chunk in
+// *offset. With at_end set, a position at the end of a chunk stays in it
+// instead of moving to the start of the next one.
+int editor_chunks_locate(
+  struct editor_chunks *chunks,
+  int at,
+  int at_end,
+  int *offset) {
+  int k = 0;
+  while (k < chunks->num_chunks - 1 &&
+         (at > chunks->chunk[k].size ||
+          (!at_end && at == chunks->chunk[k].size))) {
+    at -= chunks->chunk[k].size;
+    k++;
+  }
+  *offset = at;
+  return k;
+}
+
+// Returns the first chunk whose checkpoint an edit offset bytes into chunk k
+// can change. Scanning a chunk reads up to KILO_HIGHLIGHT_SLACK bytes past
+// its end, so an edit that close to the start of a chunk reaches back.
+int editor_chunks_reach(struct editor_chunks *chunks, int k, int offset) {
+  while (k > 0 && offset < KILO_HIGHLIGHT_SLACK) {
+    k--;
+    offset += chunks->chunk[k].size;
+  }
+  return k;
+}
+
+void editor_chunks_insert(editor_row *row, int at, const char *s, int len) {
+  struct editor_chunks *chunks = row->chunks;
+  int offset;
+  int k = editor_chunks_locate(chunks, at, 1, &offset);
+  int from = editor_chunks_reach(chunks, k, offset);
+  struct editor_chunk *chunk = &chunks->chunk[k];
+  if (chunk->size + len <= KILO_CHUNK_SIZE) {
+    memmove(
+      &chunk->data[offset + len],
+      &chunk->data[offset],
+      chunk->size - offset);
+    memcpy(&chunk->data[offset], s, len);
+    chunk->size += len;
+    chunk->tabs += editor_count_tabs(s, len);
+    editor_chunks_touch(chunks, from, k);
+  } else {
+    // A chunk that would overflow is cut up again together with what goes
+    // into it. The first piece starts where it did, so it keeps the
+    // checkpoint.
+    int skip = chunk->skip;
+    struct editor_highlight_state state = chunk->state;
+    int size = chunk->size + len;
+    char *text = malloc(size);
+    if (text == NULL) {
+      die("malloc");
+    }
+    memcpy(text, chunk->data, offset);
+    memcpy(&text[offset], s, len);
+    memcpy(&text[offset + len], &chunk->data[offset], chunk->size - offset);
+    editor_chunks_close(chunks, k);
+    editor_chunks_fill(chunks, k, text, size);
+    chunks->chunk[k].skip = skip;
+    chunks->chunk[k].state = state;
+    editor_chunks_touch(chunks, from, k);
+    free(text);
+  }
+  row->size += len;
+}
+
+void editor_chunks_delete(editor_row *row, int at) {
+  struct editor_chunks *chunks = row->chunks;
+  int offset;
+  int k = editor_chunks_locate(chunks, at, 0, &offset);
+  int from = editor_chunks_reach(chunks, k, offset);
+  struct editor_chunk *chunk = &chunks->chunk[k];
+  if (chunk->data[offset] == '\t') {
+    chunk->tabs--;
+  }
+  memmove(
+    &chunk->data[offset],
+    &chunk->data[offset + 1],
+    chunk->size - offset - 1);
+  chunk->size--;
+  row->size--;
+
+  // An emptied chunk goes away, and the one taking its place gets its
+  // checkpoint from the chunks before.
+  if (chunk->size == 0 && chunks->num_chunks > 1) {
+    editor_chunks_close(chunks, k);
+    int last = chunks->num_chunks - 1;
+    editor_chunks_touch(chunks, from, k < last ? k : last);
+  } else {
+    editor_chunks_touch(chunks, from, k);
+  }
+}
+
+// Returns how many render columns len bytes of s take up when they start at
+// render column render_x.
+int editor_chunk_columns(const char *s, int len, int render_x) {
+  int x = render_x;
+  int j;
+  for (j = 0; j < len; j++) {
+    if (s[j] == '\t') {
+      x += KILO_TAB_STOP - x % KILO_TAB_STOP;
+    } else {
+      x++;
+    }
+  }
+  return x - render_x;
+}
+
+// Lays out the columns of the chunks edited since the last call, and of the
+// ones after them until one starts at the same tab alignment as before.
+// Every chunk from there on keeps its width and only moves over.
+void editor_chunks_render(editor_row *row) {
+  struct editor_chunks *chunks = row->chunks;
+  row->num_tabs = 0;
+  if (chunks->render_from > chunks->render_to) {
+    return;
+  }
+
+  int k = chunks->render_from;
+  int render_x = 0;
+  if (k > 0) {
+    render_x = chunks->chunk[k - 1].render_x + chunks->chunk[k - 1].width;
+  }
+  for (; k < chunks->num_chunks; k++) {
+    struct editor_chunk *chunk = &chunks->chunk[k];
+    if (k > chunks->render_to &&
+        (render_x - chunk->render_x) % KILO_TAB_STOP == 0) {
+      break;
+    }
+    chunk->render_x = render_x;
+    chunk->width = chunk->tabs ?
+      editor_chunk_columns(chunk->data, chunk->size, render_x) :
+      chunk->size;
+    render_x += chunk->width;
+  }
+  if (k < chunks->num_chunks) {
+    int delta = render_x - chunks->chunk[k].render_x;
+    for (; k < chunks->num_chunks; k++) {
+      chunks->chunk[k].render_x += delta;
+    }
+  }
+
+  struct editor_chunk *last = &chunks->chunk[chunks->num_chunks - 1];
+  chunks->width = last->render_x + last->width;
+  chunks->render_from = INT_MAX;
+  chunks->render_to = -1;
+  chunks->window_valid = 0;
+}
+
+// Brings the checkpoints of a long row up to date for a row starting inside
+// a multi-line comment if in_comment is set, and returns whether it ends
+// inside one. Each chunk is scanned with enough of the next ones behind it
+// to match any token running over. Only reads syntax and the row, so rows
+// can be highlighted from several threads at once.
+int editor_chunks_highlight(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment) {
+  struct editor_chunks *chunks = row->chunks;
+  if (syntax == NULL) {
+    return in_comment;
+  }
+
+  struct editor_highlight_state state = {in_comment, 0, 1, 0, 0};
+  struct editor_chunk *first = &chunks->chunk[0];
+  if (first->skip != 0 || memcmp(&first->state, &state, sizeof(state))) {
+    first->skip = 0;
+    first->state = state;
+    chunks->highlight_from = 0;
+    if (chunks->highlight_to < 0) {
+      chunks->highlight_to = 0;
+    }
+  }
+  if (chunks->highlight_from > chunks->highlight_to) {
+    return chunks->end_in_comment;
+  }
+  TRACE_SCOPE("editor_chunks_highlight");
+
+  char text[KILO_CHUNK_SIZE + KILO_HIGHLIGHT_SLACK + 1];
+  unsigned char hl[KILO_CHUNK_SIZE + KILO_HIGHLIGHT_SLACK];
+  int k = chunks->highlight_from;
+  int skip = chunks->chunk[k].skip;
+  state = chunks->chunk[k].state;
+  for (;;) {
+    struct editor_chunk *chunk = &chunks->chunk[k];
+    int size = editor_chunks_gather(
+      chunks,
+      k,
+      text,
+      chunk->size + KILO_HIGHLIGHT_SLACK);
+    skip = editor_highlight_scan(
+      syntax,
+      text,
+      size,
+      skip,
+      chunk->size,
+      &state,
+      hl);
+    skip -= chunk->size;
+
+    k++;
+    if (k == chunks->num_chunks) {
+      chunks->end_in_comment = state.in_comment;
+      break;
+    }
+    struct editor_chunk *next = &chunks->chunk[k];
+    if (k > chunks->highlight_to && next->skip == skip &&
+        !memcmp(&next->state, &state, sizeof(state))) {
+      break;
+    }
+    next->skip = skip;
+    next->state = state;
+  }
+
+  chunks->highlight_from = INT_MAX;
+  chunks->highlight_to = -1;
+  chunks->window_valid = 0;
+  return chunks->end_in_comment;
+}
+
+// Returns the chunk holding render column render_x, or the last one for a
+// column past the end.
+int editor_chunks_find_column(struct editor_chunks *chunks, int render_x) {
+  int lo = 0;
+  int hi = chunks->num_chunks;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (chunks->chunk[mid].render_x <= render_x) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? lo - 1 : 0;
+}
+
+// Renders and highlights the columns of a long row that fit on screen from
+// E.col_offset on, unless that window is still the one rendered last.
+void editor_chunks_window(editor_row *row) {
+  struct editor_chunks *chunks = row->chunks;
+  if (chunks->window_valid && chunks->window_start == E.col_offset &&
+      chunks->window_cols == E.screen_cols) {
+    return;
+  }
+  TRACE_SCOPE("editor_chunks_window");
+  size_t bytes = editor_row_cache_bytes(row);
+
+  int start = E.col_offset;
+  int end = start + E.screen_cols;
+  if (end > chunks->width) {
+    end = chunks->width;
+  }
+  if (start > end) {
+    start = end;
+  }
+  int length = end - start;
+
+  if (length + 1 > row->render_capacity) {
+    row->render_capacity = editor_grow_capacity(
+      row->render_capacity,
+      length + 1);
+    free(row->render_buffer);
+    row->render_buffer = malloc(row->render_capacity);
+    if (row->render_buffer == NULL) {
+      die("malloc");
+    }
+  }
+  unsigned char *hl = editor_highlight_scratch(length + 1);
+  memset(hl, HL_NORMAL, length);
+
+  if (length > 0) {
+    // Find the first char on screen, then the last checkpoint before it.
+    int k = editor_chunks_find_column(chunks, start);
+    struct editor_chunk *chunk = &chunks->chunk[k];
+    int render_x = chunk->render_x;
+    int first = 0;
+    while (first < chunk->size) {
+      int width = chunk->data[first] == '\t' ?
+        KILO_TAB_STOP - render_x % KILO_TAB_STOP : 1;
+      if (render_x + width > start) {
+        break;
+      }
+      render_x += width;
+      first++;
+    }
+    while (k > 0 && chunks->chunk[k].skip > first) {
+      k--;
+      first += chunks->chunk[k].size;
+    }
+
+    // Every char on screen takes up at least one column.
+    int max = first + length + KILO_HIGHLIGHT_SLACK;
+    char *text = malloc(max + 1);
+    unsigned char *text_hl = malloc(max);
+    if (text == NULL || text_hl == NULL) {
+      die("malloc");
+    }
+    int size = editor_chunks_gather(chunks, k, text, max);
+    memset(text_hl, HL_NORMAL, size);
+    if (E.syntax) {
+      struct editor_highlight_state state = chunks->chunk[k].state;
+      editor_highlight_scan(
+        E.syntax,
+        text,
+        size,
+        chunks->chunk[k].skip,
+        first + length < size ? first + length : size,
+        &state,
+        text_hl);
+    }
+
+    render_x = chunks->chunk[k].render_x;
+    int j;
+    for (j = 0; j < size && render_x < end; j++) {
+      char c = text[j];
+      int width = 1;
+      if (c == '\t') {
+        width = KILO_TAB_STOP - render_x % KILO_TAB_STOP;
+        c = ' ';
+      } else if ((unsigned char)c >= 0x80) {
+        c = '?';
+      }
+      for (; width > 0; width--, render_x++) {
+        if (render_x >= start && render_x < end) {
+          row->render_buffer[render_x - start] = c;
+          hl[render_x - start] = text_hl[j];
+        }
+      }
+    }
+    free(text);
+    free(text_hl);
+  }
+
+  row->render_buffer[length] = '\0';
+  row->render_start = start;
+  row->render_size = end;
+  editor_row_bind(row);
+  editor_row_store_highlight(row, hl, NULL);
+  E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+
+  chunks->window_valid = 1;
+  chunks->window_start = E.col_offset;
+  chunks->window_cols = E.screen_cols;
+}
+
+int editor_chunks_cursor_x_to_render_x(editor_row *row, int cursor_x) {
+  int offset;
+  int k = editor_chunks_locate(row->chunks, cursor_x, 1, &offset);
+  struct editor_chunk *chunk = &row->chunks->chunk[k];
+  if (offset > chunk->size) {
+    return chunk->render_x + chunk->width + (offset - chunk->size);
+  }
+  if (chunk->tabs == 0) {
+    return chunk->render_x + offset;
+  }
+  return chunk->render_x +
+    editor_chunk_columns(chunk->data, offset, chunk->render_x);
+}
+
+int editor_chunks_render_x_to_cursor_x(editor_row *row, int render_x) {
+  struct editor_chunks *chunks = row->chunks;
+  int k = editor_chunks_find_column(chunks, render_x);
+  int cursor_x = 0;
+  int j;
+  for (j = 0; j < k; j++) {
+    cursor_x += chunks->chunk[j].size;
+  }
+
+  struct editor_chunk *chunk = &chunks->chunk[k];
+  int x = chunk->render_x;
+  for (j = 0; j < chunk->size; j++) {
+    x += chunk->data[j] == '\t' ? KILO_TAB_STOP - x % KILO_TAB_STOP : 1;
+    if (x > render_x) {
+      break;
+    }
+  }
+  return cursor_x + j;
+}
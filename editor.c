@@ -0,0 +1,102 @@
+#include "kilo.h"
+
+/*** data ***/
+
+struct editor_config E;
+
+/*** terminal ***/
+
+void die(const char *s) {
+  editor_write("\x1b[2J", 4);
+  editor_write("\x1b[H", 3);
+  perror(s);
+  exit(1);
+}
+
+int editor_read_key(void) {
+  if (E.macro.replaying) {
+    return editor_macro_next_key();
+  }
+  int c = E.terminal->read_key();
+  editor_stats_key();
+  if (E.macro.recording) {
+    editor_macro_record_key(c);
+  }
+  return c;
+}
+
+void editor_write(const char *buffer, int length) {
+  if (E.terminal) {
+    E.terminal->write(buffer, length);
+  }
+}
+
+// Called by terminals while no key is pending, to take in work that
+// finished in the background.
+void editor_idle(void) {
+  if (editor_index_absorb() | editor_view_absorb() | editor_follow_poll() |
+      editor_grep_absorb() | editor_wrap_idle()) {
+    editor_refresh_screen();
+  }
+}
+
+/*** threads ***/
+
+// Number of threads for parallel work, taken from $KILO_THREADS when set and
+// from the number of online processors otherwise.
+int editor_thread_count(void) {
+  char *threads = getenv("KILO_THREADS");
+  if (threads && atoi(threads) > 0) {
+    return atoi(threads);
+  }
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  return processors > 0 ? processors : 1;
+}
+
+/*** init ***/
+
+// Resets everything E keeps about the open buffer, leaving the terminal and
+// screen size alone.
+void editor_init_buffer(void) {
+  E.cursor_x = 0;
+  E.cursor_y = 0;
+  E.render_x = 0;
+  E.row_offset = 0;
+  E.col_offset = 0;
+  E.num_rows = 0;
+  E.row_capacity = 0;
+  E.row = NULL;
+  E.arena = NULL;
+  E.hl_arena = NULL;
+  E.cache_bytes = 0;
+  E.cache_clock = 0;
+  E.loading = 0;
+  E.index = NULL;
+  E.view = NULL;
+  E.undo = NULL;
+  E.panes = NULL;
+  E.wrap = NULL;
+  E.grep = NULL;
+  E.follow = NULL;
+  E.file_size = 0;
+  E.dirty = 0;
+  E.filename = NULL;
+  E.status_msg[0] = '\0';
+  E.status_msg_time = 0;
+  E.syntax = NULL;
+}
+
+void init_editor(struct editor_terminal *terminal) {
+  TRACE_INIT();
+  editor_init_sgr();
+
+  E.terminal = terminal;
+  E.cache_budget = KILO_CACHE_MEMORY;
+  editor_init_buffer();
+
+  if (terminal->get_window_size(&E.screen_rows, &E.screen_cols) == -1) {
+    die("get_window_size");
+  }
+  E.screen_rows -= 2;
+}
@@ -0,0 +1,260 @@
+#include "kilo.h"
+
+/*** follow ***/
+
+// In follow mode the file is watched with inotify and whatever is appended
+// to it is read from the last offset taken in, in batches of
+// KILO_FOLLOW_BATCH bytes for at most KILO_FOLLOW_BUDGET seconds per idle
+// tick so a fast writer cannot starve the keyboard. Only complete lines are
+// taken: a line still being written is read again once its newline arrives.
+// New rows are highlighted starting from the comment state of the last row,
+// so earlier rows are never touched. When the file is truncated the rows
+// are dropped and it is read again from the start, and when it is moved or
+// deleted, as by log rotation, the new file under the same name is followed
+// once it appears.
+
+void editor_follow_start(char *filename) {
+  struct editor_follow *follow = calloc(1, sizeof(*follow));
+  if (follow == NULL) {
+    die("calloc");
+  }
+  follow->filename = strdup(filename);
+  follow->fd = open(filename, O_RDONLY);
+  if (follow->fd == -1) {
+    die("open");
+  }
+  struct stat st;
+  if (fstat(follow->fd, &st) == -1) {
+    die("fstat");
+  }
+  follow->inode = st.st_ino;
+  follow->offset = E.file_size;
+  follow->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (follow->inotify_fd == -1) {
+    die("inotify_init1");
+  }
+  follow->watch = inotify_add_watch(
+    follow->inotify_fd,
+    filename,
+    IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+  follow->buffer = malloc(KILO_FOLLOW_BATCH);
+  if (follow->buffer == NULL) {
+    die("malloc");
+  }
+  follow->pending = 1;
+  follow->trim = 1;
+  E.follow = follow;
+}
+
+void editor_follow_stop(void) {
+  struct editor_follow *follow = E.follow;
+  if (follow == NULL) {
+    return;
+  }
+  close(follow->inotify_fd);
+  close(follow->fd);
+  free(follow->buffer);
+  free(follow->filename);
+  free(follow);
+  E.follow = NULL;
+}
+
+// editor_open keeps a last line without a newline as a row of its own. The
+// writer is most likely still in the middle of it, so it is dropped and
+// read again once it is complete.
+void editor_follow_trim(void) {
+  struct editor_follow *follow = E.follow;
+  follow->trim = 0;
+  if (follow->offset == 0 || E.num_rows == 0) {
+    return;
+  }
+
+  off_t end = follow->offset;
+  while (end > 0) {
+    off_t start = end > KILO_FOLLOW_BATCH ? end - KILO_FOLLOW_BATCH : 0;
+    ssize_t nread = pread(follow->fd, follow->buffer, end - start, start);
+    if (nread <= 0) {
+      return;
+    }
+    if (end == follow->offset && follow->buffer[nread - 1] == '\n') {
+      return;
+    }
+    char *nl = memrchr(follow->buffer, '\n', nread);
+    if (nl) {
+      end = start + (nl - follow->buffer) + 1;
+      break;
+    }
+    end = start;
+  }
+
+  int dirty = E.dirty;
+  editor_del_row(E.num_rows - 1);
+  E.dirty = dirty;
+  follow->offset = end;
+}
+
+// Moves over to the file that now has the followed name, after the old
+// one was rotated away.
+void editor_follow_reopen(void) {
+  struct editor_follow *follow = E.follow;
+  int fd = open(follow->filename, O_RDONLY);
+  struct stat st;
+  if (fd == -1 || fstat(fd, &st) == -1) {
+    if (fd != -1) {
+      close(fd);
+    }
+    return;
+  }
+  if (st.st_ino == follow->inode) {
+    close(fd);
+    return;
+  }
+
+  close(follow->fd);
+  follow->fd = fd;
+  follow->inode = st.st_ino;
+  follow->offset = 0;
+  follow->rotated = 0;
+  follow->pending = 1;
+  inotify_rm_watch(follow->inotify_fd, follow->watch);
+  follow->watch = inotify_add_watch(
+    follow->inotify_fd,
+    follow->filename,
+    IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+  editor_set_status_message("%s was replaced, following the new file",
+                            follow->filename);
+}
+
+// The file shrank below what was read of it, so the rows no longer match
+// it: they are dropped, and it is read again from the start.
+void editor_follow_truncated(void) {
+  struct editor_follow *follow = E.follow;
+  int dirty = E.dirty;
+  while (E.num_rows > 0) {
+    editor_del_row(E.num_rows - 1);
+  }
+  E.dirty = dirty;
+  E.cursor_x = 0;
+  E.cursor_y = 0;
+  E.row_offset = 0;
+  follow->offset = 0;
+  editor_set_status_message("%s was truncated", follow->filename);
+}
+
+// editor_save wrote the rows out as the whole file, length bytes, which are
+// then all taken in already.
+void editor_follow_saved(off_t length) {
+  if (E.follow) {
+    E.follow->offset = length;
+  }
+}
+
+// Takes in one batch of appended lines, and returns whether any rows were
+// added.
+int editor_follow_read(void) {
+  struct editor_follow *follow = E.follow;
+  struct stat st;
+  if (fstat(follow->fd, &st) == -1) {
+    follow->pending = 0;
+    return 0;
+  }
+  if (st.st_size < follow->offset) {
+    editor_follow_truncated();
+  }
+
+  ssize_t nread = pread(
+    follow->fd,
+    follow->buffer,
+    KILO_FOLLOW_BATCH,
+    follow->offset);
+  if (nread <= 0) {
+    follow->pending = 0;
+    return 0;
+  }
+
+  // A line longer than a whole batch is cut where the batch ends.
+  char *nl = memrchr(follow->buffer, '\n', nread);
+  size_t complete = nread;
+  if (nl) {
+    complete = nl - follow->buffer + 1;
+  } else if (nread < KILO_FOLLOW_BATCH) {
+    follow->pending = 0;
+    return 0;
+  }
+  follow->offset += complete;
+  follow->pending = (nread == KILO_FOLLOW_BATCH);
+
+  editor_row *rows = NULL;
+  int num_rows = 0;
+  int capacity = 0;
+  struct editor_arena_chunk *arena = NULL;
+  struct editor_arena_chunk *hl_arena = NULL;
+  editor_split_rows(
+    follow->buffer,
+    complete,
+    &rows,
+    &num_rows,
+    &capacity,
+    &arena);
+  editor_highlight_range(
+    E.syntax,
+    rows,
+    num_rows,
+    E.num_rows > 0 ? E.row[E.num_rows - 1].hl_open_comment : 0,
+    &hl_arena);
+
+  // The view keeps up with the end of the file while the cursor is on its
+  // last line.
+  int at_end = E.cursor_y >= E.num_rows - 1;
+  int past_end = E.cursor_y == E.num_rows;
+  editor_append_rows(rows, num_rows);
+  editor_arena_adopt(&E.arena, arena);
+  editor_arena_adopt(&E.hl_arena, hl_arena);
+  free(rows);
+  if (at_end) {
+    E.cursor_y = past_end ? E.num_rows : E.num_rows - 1;
+    E.cursor_x = 0;
+  }
+  return 1;
+}
+
+// Takes in appended lines for at most KILO_FOLLOW_BUDGET seconds, and
+// returns whether anything on screen may have changed.
+int editor_follow_poll(void) {
+  struct editor_follow *follow = E.follow;
+  if (follow == NULL || E.index) {
+    return 0;
+  }
+  TRACE_SCOPE("editor_follow_poll");
+
+  char events[4096]
+    __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t len;
+  while ((len = read(follow->inotify_fd, events, sizeof(events))) > 0) {
+    char *p = events;
+    while (p < events + len) {
+      struct inotify_event *event = (struct inotify_event *)p;
+      if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) {
+        follow->rotated = 1;
+      }
+      follow->pending = 1;
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  if (follow->rotated) {
+    editor_follow_reopen();
+  }
+
+  int changed = 0;
+  if (follow->trim) {
+    editor_follow_trim();
+    changed = 1;
+  }
+
+  double start = editor_stats_now();
+  while (follow->pending &&
+         editor_stats_now() - start < KILO_FOLLOW_BUDGET) {
+    changed |= editor_follow_read();
+  }
+  return changed;
+}
@@ -0,0 +1,680 @@
+#include "kilo.h"
+
+/*** project search ***/
+
+// Ctrl-P searches every file under the current directory and shows what it
+// finds as a buffer of its own, one "path:line:text" row per matching line,
+// which fills in while the search runs. Enter on a row opens that file at
+// that line. A pool of threads walks the tree: each keeps a queue of its own
+// of directories to list and files to search, works from the back of it,
+// and when it runs dry takes from the front of another's. Hidden entries
+// and symlinks are skipped, as are files that look binary. Only the main
+// thread touches E.row: it appends whatever results are ready when idle or
+// before painting, as it does with the indexer's batches.
+
+// The bytes of source text from most common to least, roughly. The query
+// byte that comes last here is the one candidates are found by.
+const char editor_grep_common[] =
+  " etaoinsrlcdhupmfgbyw\n_.,()=;\t*\"'/-{}>xkv0123456789[]<:&!#+"
+  "ETAOINSRLCDHUPMFGBYWXKVqjzQJZ";
+
+// Returns where in query its rarest byte is.
+int editor_grep_rarest(const char *query, size_t len) {
+  size_t rare = 0;
+  int rank = -1;
+  size_t j;
+  for (j = 0; j < len; j++) {
+    const char *common = strchr(editor_grep_common, query[j]);
+    int this_rank = common && query[j] ?
+      (int)(common - editor_grep_common) :
+      (int)sizeof(editor_grep_common);
+    if (this_rank > rank) {
+      rank = this_rank;
+      rare = j;
+    }
+  }
+  return rare;
+}
+
+// Returns the first occurrence of the query in [p, end). Candidates are
+// found with memchr on the query's rarest byte, which turns up the fewest
+// false starts.
+const char *editor_grep_find(
+  struct editor_grep *grep,
+  const char *p,
+  const char *end) {
+  size_t len = grep->query_len;
+  char c = grep->query[grep->rare];
+  while ((size_t)(end - p) >= len) {
+    const char *at = memchr(p + grep->rare, c, end - p - len + 1);
+    if (at == NULL) {
+      return NULL;
+    }
+    const char *start = at - grep->rare;
+    if (!memcmp(start, grep->query, len)) {
+      return start;
+    }
+    p = start + 1;
+  }
+  return NULL;
+}
+
+/*** queues ***/
+
+void editor_grep_push(
+  struct editor_grep_worker *worker,
+  char *path,
+  int is_dir) {
+  struct editor_grep_queue *queue = &worker->queue;
+  pthread_mutex_lock(&queue->lock);
+  if (queue->tail == queue->capacity) {
+    if (queue->head > 0) {
+      memmove(
+        queue->tasks,
+        &queue->tasks[queue->head],
+        sizeof(struct editor_grep_task) * (queue->tail - queue->head));
+      queue->tail -= queue->head;
+      queue->head = 0;
+    } else {
+      queue->capacity = queue->capacity ? queue->capacity * 2 : 64;
+      queue->tasks = realloc(
+        queue->tasks,
+        sizeof(struct editor_grep_task) * queue->capacity);
+      if (queue->tasks == NULL) {
+        die("realloc");
+      }
+    }
+  }
+  queue->tasks[queue->tail].path = path;
+  queue->tasks[queue->tail].is_dir = is_dir;
+  queue->tail++;
+  pthread_mutex_unlock(&queue->lock);
+}
+
+// Takes the newest task from the back of queue for its owner, or the
+// oldest from the front for another worker, and returns whether there was
+// one. Directories queued early sit near the front, so a thief tends to
+// walk off with a whole subtree.
+int editor_grep_take(
+  struct editor_grep_queue *queue,
+  int steal,
+  struct editor_grep_task *task) {
+  pthread_mutex_lock(&queue->lock);
+  int found = queue->head < queue->tail;
+  if (found) {
+    *task = steal ? queue->tasks[queue->head++] : queue->tasks[--queue->tail];
+    if (queue->head == queue->tail) {
+      queue->head = 0;
+      queue->tail = 0;
+    }
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+int editor_grep_next_task(
+  struct editor_grep_worker *worker,
+  struct editor_grep_task *task) {
+  struct editor_grep *grep = worker->grep;
+  if (editor_grep_take(&worker->queue, 0, task)) {
+    return 1;
+  }
+  int j;
+  for (j = 1; j < grep->num_workers; j++) {
+    struct editor_grep_worker *victim =
+      &grep->workers[(worker->id + j) % grep->num_workers];
+    if (editor_grep_take(&victim->queue, 1, task)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*** search ***/
+
+void editor_grep_add_result(
+  struct editor_grep_worker *worker,
+  const char *path,
+  int line,
+  const char *text,
+  int length) {
+  struct editor_grep_batch *batch = worker->batch;
+  if (batch == NULL) {
+    batch = calloc(1, sizeof(*batch));
+    if (batch == NULL) {
+      die("calloc");
+    }
+    worker->batch = batch;
+  }
+  if (batch->num_results == batch->capacity) {
+    batch->capacity = editor_grow_capacity(
+      batch->capacity,
+      batch->num_results + 1);
+    batch->results = realloc(
+      batch->results,
+      sizeof(struct editor_grep_result) * batch->capacity);
+    if (batch->results == NULL) {
+      die("realloc");
+    }
+  }
+
+  while (length > 0 && text[length - 1] == '\r') {
+    length--;
+  }
+  if (length > KILO_GREP_LINE) {
+    length = KILO_GREP_LINE;
+  }
+  char number[16];
+  int path_length = strlen(path);
+  int number_length = snprintf(number, sizeof(number), ":%d:", line);
+  struct editor_grep_result *result = &batch->results[batch->num_results++];
+  result->length = path_length + number_length + length;
+  result->text = malloc(result->length);
+  if (result->text == NULL) {
+    die("malloc");
+  }
+  memcpy(result->text, path, path_length);
+  memcpy(&result->text[path_length], number, number_length);
+  memcpy(&result->text[path_length + number_length], text, length);
+  result->path_length = path_length;
+  result->line = line;
+}
+
+// Adds a result for every line of data that holds the query. data starts
+// on line *line, or line 1 when line is NULL. Lines are only counted up to
+// each match, so a file with none costs one pass of memchr; with line set,
+// the rest are counted too, and *line is left at the line after data.
+void editor_grep_scan(
+  struct editor_grep_worker *worker,
+  const char *path,
+  const char *data,
+  size_t size,
+  int *line) {
+  struct editor_grep *grep = worker->grep;
+  const char *end = data + size;
+  const char *p = data;
+  int number = line ? *line : 1;
+  const char *match;
+  while ((match = editor_grep_find(grep, p, end))) {
+    const char *start = match;
+    while (start > p && start[-1] != '\n') {
+      start--;
+    }
+    number += editor_count_lines(p, start);
+    const char *nl = memchr(match, '\n', end - match);
+    const char *stop = nl ? nl : end;
+    editor_grep_add_result(worker, path, number, start, stop - start);
+    if (nl == NULL) {
+      p = end;
+      break;
+    }
+    p = nl + 1;
+    number++;
+  }
+  if (line) {
+    *line = number + editor_count_lines(p, end);
+  }
+}
+
+// Grows the worker's buffer to hold at least size bytes, keeping what is
+// in it.
+void editor_grep_reserve(struct editor_grep_worker *worker, size_t size) {
+  if (size <= worker->capacity) {
+    return;
+  }
+  worker->capacity = size;
+  worker->buffer = realloc(worker->buffer, worker->capacity);
+  if (worker->buffer == NULL) {
+    die("realloc");
+  }
+}
+
+// Searches a large file KILO_GREP_BLOCK bytes at a time. Each block is
+// searched up to its last newline, and the line it ends in is carried over
+// to the front of the next. A line longer than the buffer grows it. Reading
+// rather than mapping means a file truncated during the search only ends
+// early, where a mapping would fault.
+void editor_grep_blocks(
+  struct editor_grep_worker *worker,
+  const char *path,
+  int fd) {
+  editor_grep_reserve(worker, KILO_GREP_BLOCK);
+  size_t kept = 0;
+  int line = 1;
+  int first = 1;
+  while (1) {
+    if (kept == worker->capacity) {
+      editor_grep_reserve(worker, worker->capacity * 2);
+    }
+    char *data = worker->buffer;
+    ssize_t nread = read(fd, &data[kept], worker->capacity - kept);
+    if (nread == -1 && errno == EINTR) {
+      continue;
+    }
+    if (nread <= 0) {
+      if (nread == 0 && kept > 0) {
+        editor_grep_scan(worker, path, data, kept, &line);
+      }
+      return;
+    }
+    if (first) {
+      size_t prefix = nread < KILO_GREP_BINARY ? nread : KILO_GREP_BINARY;
+      if (memchr(data, '\0', prefix)) {
+        return;
+      }
+      first = 0;
+    }
+
+    size_t filled = kept + nread;
+    char *nl = memrchr(data, '\n', filled);
+    if (nl == NULL) {
+      kept = filled;
+      continue;
+    }
+    size_t complete = nl - data + 1;
+    editor_grep_scan(worker, path, data, complete, &line);
+    kept = filled - complete;
+    memmove(data, &data[complete], kept);
+  }
+}
+
+// Searches the file at path, reading a small one into the worker's buffer
+// in one go and a large one a block at a time. A NUL among its first
+// KILO_GREP_BINARY bytes marks it as binary, and it is skipped.
+void editor_grep_file(struct editor_grep_worker *worker, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return;
+  }
+
+  size_t size = st.st_size;
+  if (size >= KILO_GREP_BLOCK) {
+    editor_grep_blocks(worker, path, fd);
+    close(fd);
+    return;
+  }
+
+  editor_grep_reserve(worker, size);
+  char *data = worker->buffer;
+  size_t filled = 0;
+  while (filled < size) {
+    ssize_t nread = read(fd, &data[filled], size - filled);
+    if (nread == -1 && errno == EINTR) {
+      continue;
+    }
+    if (nread <= 0) {
+      break;
+    }
+    filled += nread;
+  }
+  size = filled;
+  close(fd);
+
+  size_t prefix = size < KILO_GREP_BINARY ? size : KILO_GREP_BINARY;
+  if (memchr(data, '\0', prefix) == NULL) {
+    editor_grep_scan(worker, path, data, size, NULL);
+  }
+}
+
+// Queues every entry of the directory at path but hidden ones and symlinks.
+// They are counted as pending before any can be taken, so that pending
+// cannot drop to zero while some are still queued.
+void editor_grep_dir(struct editor_grep_worker *worker, const char *path) {
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    return;
+  }
+  worker->num_found = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    // The root is left off the paths, which are relative to it.
+    size_t length = strlen(entry->d_name);
+    size_t prefix = strcmp(path, ".") ? strlen(path) + 1 : 0;
+    char *child = malloc(prefix + length + 1);
+    if (child == NULL) {
+      die("malloc");
+    }
+    if (prefix) {
+      memcpy(child, path, prefix - 1);
+      child[prefix - 1] = '/';
+    }
+    memcpy(&child[prefix], entry->d_name, length + 1);
+
+    int type = entry->d_type;
+    if (type == DT_UNKNOWN) {
+      struct stat st;
+      if (lstat(child, &st) == 0) {
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : 0;
+      }
+    }
+    if (type != DT_DIR && type != DT_REG) {
+      free(child);
+      continue;
+    }
+    if (worker->num_found == worker->found_capacity) {
+      worker->found_capacity = editor_grow_capacity(
+        worker->found_capacity,
+        worker->num_found + 1);
+      worker->found = realloc(
+        worker->found,
+        sizeof(struct editor_grep_task) * worker->found_capacity);
+      if (worker->found == NULL) {
+        die("realloc");
+      }
+    }
+    worker->found[worker->num_found].path = child;
+    worker->found[worker->num_found].is_dir = type == DT_DIR;
+    worker->num_found++;
+  }
+  closedir(dir);
+
+  struct editor_grep *grep = worker->grep;
+  pthread_mutex_lock(&grep->lock);
+  grep->pending += worker->num_found;
+  pthread_mutex_unlock(&grep->lock);
+  int j;
+  for (j = 0; j < worker->num_found; j++) {
+    editor_grep_push(worker, worker->found[j].path, worker->found[j].is_dir);
+  }
+}
+
+// Runs tasks until there are none left anywhere or the search is
+// cancelled. pending counts the tasks queued or running across the pool,
+// so a worker that finds every queue empty waits for more to be queued
+// until it drops to zero.
+void *editor_grep_worker(void *arg) {
+  TRACE_SCOPE("editor_grep_worker");
+  struct editor_grep_worker *worker = arg;
+  struct editor_grep *grep = worker->grep;
+  while (1) {
+    pthread_mutex_lock(&grep->lock);
+    long pushes = grep->pushes;
+    int cancel = grep->cancel;
+    pthread_mutex_unlock(&grep->lock);
+    if (cancel) {
+      break;
+    }
+
+    struct editor_grep_task task;
+    if (!editor_grep_next_task(worker, &task)) {
+      pthread_mutex_lock(&grep->lock);
+      while (!grep->cancel && grep->pending > 0 && grep->pushes == pushes) {
+        pthread_cond_wait(&grep->ready, &grep->lock);
+      }
+      int finished = grep->cancel || grep->pending == 0;
+      pthread_mutex_unlock(&grep->lock);
+      if (finished) {
+        break;
+      }
+      continue;
+    }
+
+    worker->num_found = 0;
+    if (task.is_dir) {
+      editor_grep_dir(worker, task.path);
+    } else {
+      editor_grep_file(worker, task.path);
+    }
+    free(task.path);
+
+    struct editor_grep_batch *batch = worker->batch;
+    worker->batch = NULL;
+    pthread_mutex_lock(&grep->lock);
+    if (batch) {
+      if (grep->tail) {
+        grep->tail->next = batch;
+      } else {
+        grep->head = batch;
+      }
+      grep->tail = batch;
+    }
+    grep->files += !task.is_dir;
+    grep->pending--;
+    if (worker->num_found) {
+      grep->pushes++;
+    }
+    if (worker->num_found || grep->pending == 0) {
+      pthread_cond_broadcast(&grep->ready);
+    }
+    pthread_mutex_unlock(&grep->lock);
+  }
+  return NULL;
+}
+
+/*** results ***/
+
+// Starts searching the tree under root for query, with the results going
+// into the empty buffer E holds.
+void editor_grep_start(char *root, char *query) {
+  struct editor_grep *grep = calloc(1, sizeof(*grep));
+  if (grep == NULL) {
+    die("calloc");
+  }
+  grep->query = strdup(query);
+  grep->query_len = strlen(query);
+  grep->rare = editor_grep_rarest(query, grep->query_len);
+  grep->title = malloc(grep->query_len + 8);
+  if (grep->query == NULL || grep->title == NULL) {
+    die("malloc");
+  }
+  snprintf(grep->title, grep->query_len + 8, "grep %s", query);
+  grep->start = editor_stats_now();
+  pthread_mutex_init(&grep->lock, NULL);
+  pthread_cond_init(&grep->ready, NULL);
+
+  grep->num_workers = editor_thread_count();
+  grep->workers = calloc(grep->num_workers, sizeof(*grep->workers));
+  if (grep->workers == NULL) {
+    die("calloc");
+  }
+  int j;
+  for (j = 0; j < grep->num_workers; j++) {
+    grep->workers[j].grep = grep;
+    grep->workers[j].id = j;
+    pthread_mutex_init(&grep->workers[j].queue.lock, NULL);
+  }
+  editor_grep_push(&grep->workers[0], strdup(root), 1);
+  grep->pending = 1;
+  E.grep = grep;
+
+  for (j = 0; j < grep->num_workers; j++) {
+    if (pthread_create(
+        &grep->workers[j].thread,
+        NULL,
+        editor_grep_worker,
+        &grep->workers[j]) != 0) {
+      die("pthread_create");
+    }
+  }
+}
+
+void editor_grep_free_batches(struct editor_grep_batch *batch) {
+  while (batch) {
+    struct editor_grep_batch *next = batch->next;
+    int j;
+    for (j = 0; j < batch->num_results; j++) {
+      free(batch->results[j].text);
+    }
+    free(batch->results);
+    free(batch);
+    batch = next;
+  }
+}
+
+// Waits for the workers, which have run out of tasks or been cancelled,
+// and frees the pool. The results already found stay.
+void editor_grep_finish(void) {
+  struct editor_grep *grep = E.grep;
+  int j;
+  for (j = 0; j < grep->num_workers; j++) {
+    struct editor_grep_worker *worker = &grep->workers[j];
+    pthread_join(worker->thread, NULL);
+    struct editor_grep_task task;
+    while (editor_grep_take(&worker->queue, 0, &task)) {
+      free(task.path);
+    }
+    free(worker->queue.tasks);
+    pthread_mutex_destroy(&worker->queue.lock);
+    free(worker->buffer);
+    free(worker->found);
+    editor_grep_free_batches(worker->batch);
+  }
+  free(grep->workers);
+  grep->workers = NULL;
+  grep->num_workers = 0;
+  grep->finished = 1;
+}
+
+// Appends every result found so far to E.row, and returns whether anything
+// on screen may have changed.
+int editor_grep_absorb(void) {
+  struct editor_grep *grep = E.grep;
+  if (grep == NULL || grep->finished) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&grep->lock);
+  struct editor_grep_batch *batch = grep->head;
+  int done = grep->pending == 0;
+  grep->head = NULL;
+  grep->tail = NULL;
+  pthread_mutex_unlock(&grep->lock);
+
+  int changed = batch != NULL || done;
+  if (batch) {
+    TRACE_SCOPE("editor_grep_absorb");
+    struct editor_grep_batch *next;
+    for (next = batch; next; next = next->next) {
+      int needed = grep->num_matches + next->num_results;
+      if (needed > grep->match_capacity) {
+        grep->match_capacity = editor_grow_capacity(
+          grep->match_capacity,
+          needed);
+        grep->matches = realloc(
+          grep->matches,
+          sizeof(struct editor_grep_match) * grep->match_capacity);
+        if (grep->matches == NULL) {
+          die("realloc");
+        }
+      }
+      int j;
+      for (j = 0; j < next->num_results; j++) {
+        struct editor_grep_result *result = &next->results[j];
+        editor_insert_row(E.num_rows, result->text, result->length);
+        grep->matches[grep->num_matches].path_length = result->path_length;
+        grep->matches[grep->num_matches].line = result->line;
+        grep->num_matches++;
+      }
+    }
+    editor_grep_free_batches(batch);
+    E.dirty = 0;
+  }
+
+  if (done) {
+    editor_grep_finish();
+    editor_set_status_message(
+      "%d matches in %ld files in %.2f s (Enter to open one)",
+      grep->num_matches,
+      grep->files,
+      editor_stats_now() - grep->start);
+  }
+  return changed;
+}
+
+// Stops the search, if it is still running, and drops the results, as when
+// the results buffer is closed.
+void editor_grep_cancel(void) {
+  struct editor_grep *grep = E.grep;
+  if (grep == NULL) {
+    return;
+  }
+  if (!grep->finished) {
+    pthread_mutex_lock(&grep->lock);
+    grep->cancel = 1;
+    pthread_cond_broadcast(&grep->ready);
+    pthread_mutex_unlock(&grep->lock);
+    editor_grep_finish();
+    editor_grep_free_batches(grep->head);
+  }
+  pthread_mutex_destroy(&grep->lock);
+  pthread_cond_destroy(&grep->ready);
+  free(grep->matches);
+  free(grep->query);
+  free(grep->title);
+  free(grep);
+  E.grep = NULL;
+}
+
+long editor_grep_files(void) {
+  pthread_mutex_lock(&E.grep->lock);
+  long files = E.grep->files;
+  pthread_mutex_unlock(&E.grep->lock);
+  return files;
+}
+
+/*** commands ***/
+
+// Replaces the buffer with the results of searching the current directory.
+void editor_grep(void) {
+  if (E.terminal->detach) {
+    // Server buffers are found by the file they hold.
+    editor_set_status_message("Project search is not available here");
+    return;
+  }
+  if (E.dirty && E.grep == NULL) {
+    editor_set_status_message("Save changes before searching files");
+    return;
+  }
+  char *query = editor_prompt("Search files: %s (ESC to cancel)", NULL);
+  if (query == NULL) {
+    return;
+  }
+  if (query[0] == '\0') {
+    free(query);
+    return;
+  }
+  editor_close();
+  editor_grep_start(".", query);
+  editor_set_status_message("Searching files for %s", query);
+  free(query);
+}
+
+// Opens the file of the result under the cursor at its line.
+void editor_grep_open(void) {
+  struct editor_grep *grep = E.grep;
+  if (E.cursor_y >= grep->num_matches) {
+    return;
+  }
+  struct editor_grep_match *match = &grep->matches[E.cursor_y];
+  char *path = malloc(match->path_length + 1);
+  if (path == NULL) {
+    die("malloc");
+  }
+  memcpy(path, E.row[E.cursor_y].chars, match->path_length);
+  path[match->path_length] = '\0';
+  int line = match->line;
+  if (access(path, R_OK) == -1) {
+    editor_set_status_message("Can't open %s", path);
+    free(path);
+    return;
+  }
+
+  editor_close();
+  if (editor_view_needed(path)) {
+    editor_view_open(path, KILO_VIEW_MEMORY);
+  } else {
+    editor_open(path);
+  }
+  free(path);
+  editor_wait_rows(line);
+  E.cursor_y = line - 1 < E.num_rows ? line - 1 : E.num_rows;
+  E.row_offset = E.cursor_y;
+}
@@ -0,0 +1,243 @@
+#include "kilo.h"
+
+/*** background indexing ***/
+
+// editor_open loads just enough of a large file to paint the first screen
+// and leaves the rest mapped for an indexer thread. The indexer splits and
+// highlights the remainder in batches of about KILO_INDEX_BATCH bytes,
+// building each batch into rows of its own, and queues them. Only the main
+// thread touches E.row: it appends whatever batches are ready when idle or
+// before painting, and blocks in editor_wait_rows when it needs rows that
+// have not been indexed yet.
+
+// Returns the length of the prefix of data that editor_open loads before
+// showing the file, which is all of it for files that load quickly anyway.
+size_t editor_index_prefix(const char *data, size_t size) {
+  if (size <= KILO_INDEX_BATCH) {
+    return size;
+  }
+
+  const char *p = data;
+  const char *end = data + size;
+  int rows = 0;
+  while (p < end && rows <= E.screen_rows) {
+    const char *nl = memchr(p, '\n', end - p);
+    p = nl ? nl + 1 : end;
+    rows++;
+  }
+  return p - data;
+}
+
+void *editor_index_worker(void *arg) {
+  TRACE_SCOPE("editor_index_worker");
+  struct editor_index *index = arg;
+  size_t offset = index->offset;
+  int in_comment = index->in_comment;
+
+  while (offset < index->size) {
+    pthread_mutex_lock(&index->lock);
+    int cancel = index->cancel;
+    pthread_mutex_unlock(&index->lock);
+    if (cancel) {
+      break;
+    }
+
+    size_t stop = offset + KILO_INDEX_BATCH;
+    if (stop >= index->size) {
+      stop = index->size;
+    } else {
+      const char *nl =
+        memchr(&index->data[stop], '\n', index->size - stop);
+      stop = nl ? (size_t)(nl - index->data) + 1 : index->size;
+    }
+
+    struct editor_row_batch *batch = calloc(1, sizeof(*batch));
+    if (batch == NULL) {
+      die("calloc");
+    }
+    batch->in_comment = in_comment;
+    int capacity = 0;
+    editor_split_rows(
+      &index->data[offset],
+      stop - offset,
+      &batch->rows,
+      &batch->num_rows,
+      &capacity,
+      &batch->arena);
+    editor_highlight_range(
+      index->syntax,
+      batch->rows,
+      batch->num_rows,
+      in_comment,
+      &batch->hl_arena);
+    if (index->syntax && batch->num_rows > 0) {
+      in_comment = batch->rows[batch->num_rows - 1].hl_open_comment;
+    }
+    batch->end = stop;
+    offset = stop;
+
+    pthread_mutex_lock(&index->lock);
+    if (index->tail) {
+      index->tail->next = batch;
+    } else {
+      index->head = batch;
+    }
+    index->tail = batch;
+    pthread_cond_signal(&index->ready);
+    pthread_mutex_unlock(&index->lock);
+  }
+
+  pthread_mutex_lock(&index->lock);
+  index->done = 1;
+  pthread_cond_signal(&index->ready);
+  pthread_mutex_unlock(&index->lock);
+  return NULL;
+}
+
+// Starts indexing data from offset on. The rows before offset must already
+// be in E.row, and data must stay mapped until indexing finishes.
+void editor_index_start(char *data, size_t size, size_t offset) {
+  struct editor_index *index = calloc(1, sizeof(*index));
+  if (index == NULL) {
+    die("calloc");
+  }
+  index->data = data;
+  index->size = size;
+  index->offset = offset;
+  index->indexed = offset;
+  index->in_comment =
+    E.num_rows > 0 ? E.row[E.num_rows - 1].hl_open_comment : 0;
+  index->syntax = E.syntax;
+  pthread_mutex_init(&index->lock, NULL);
+  pthread_cond_init(&index->ready, NULL);
+  E.index = index;
+
+  if (pthread_create(&index->thread, NULL, editor_index_worker, index) != 0) {
+    die("pthread_create");
+  }
+}
+
+void editor_index_finish(void) {
+  struct editor_index *index = E.index;
+  pthread_join(index->thread, NULL);
+  while (index->head) {
+    struct editor_row_batch *next = index->head->next;
+    int j;
+    for (j = 0; j < index->head->num_rows; j++) {
+      editor_free_row(&index->head->rows[j]);
+    }
+    editor_arena_adopt(&E.arena, index->head->arena);
+    editor_arena_adopt(&E.hl_arena, index->head->hl_arena);
+    free(index->head->rows);
+    free(index->head);
+    index->head = next;
+  }
+  munmap(index->data, index->size);
+  pthread_mutex_destroy(&index->lock);
+  pthread_cond_destroy(&index->ready);
+  free(index);
+  E.index = NULL;
+}
+
+// The indexer carries the comment state over from its own last batch, but
+// an edit to the last row appended since can change it. Highlights the
+// rows of batch again from the state E.row now ends in, until they agree
+// with what the indexer found.
+void editor_index_stitch(struct editor_row_batch *batch) {
+  if (E.syntax == NULL || E.num_rows == 0) {
+    return;
+  }
+  int entry = E.row[E.num_rows - 1].hl_open_comment;
+  int assumed = batch->in_comment;
+  unsigned char *hl = NULL;
+  int hl_capacity = 0;
+  int at = 0;
+  while (at < batch->num_rows && entry != assumed) {
+    editor_row *row = &batch->rows[at];
+    assumed = row->hl_open_comment;
+    entry = editor_row_highlight(
+      E.syntax,
+      row,
+      entry,
+      &hl,
+      &hl_capacity,
+      &batch->hl_arena);
+    row->hl_open_comment = entry;
+    at++;
+  }
+  free(hl);
+}
+
+// Appends every batch the indexer has finished to E.row, and returns
+// whether anything on screen may have changed.
+int editor_index_absorb(void) {
+  struct editor_index *index = E.index;
+  if (index == NULL) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&index->lock);
+  struct editor_row_batch *batch = index->head;
+  int done = index->done;
+  index->head = NULL;
+  index->tail = NULL;
+  pthread_mutex_unlock(&index->lock);
+
+  int changed = batch != NULL || done;
+  if (batch) {
+    TRACE_SCOPE("editor_index_absorb");
+    while (batch) {
+      struct editor_row_batch *next = batch->next;
+      editor_index_stitch(batch);
+      editor_append_rows(batch->rows, batch->num_rows);
+      editor_arena_adopt(&E.arena, batch->arena);
+      editor_arena_adopt(&E.hl_arena, batch->hl_arena);
+      index->indexed = batch->end;
+      free(batch->rows);
+      free(batch);
+      batch = next;
+    }
+  }
+
+  if (done) {
+    editor_index_finish();
+  }
+  return changed;
+}
+
+// Blocks until the row table holds at least rows rows or the whole file
+// has been indexed, or for a view, scanned.
+void editor_wait_rows(int rows) {
+  if (E.view) {
+    editor_view_wait(rows);
+    return;
+  }
+  while (E.index && E.num_rows < rows) {
+    struct editor_index *index = E.index;
+    pthread_mutex_lock(&index->lock);
+    while (index->head == NULL && !index->done) {
+      pthread_cond_wait(&index->ready, &index->lock);
+    }
+    pthread_mutex_unlock(&index->lock);
+    editor_index_absorb();
+  }
+}
+
+// Stops the indexer without waiting for the rest of the file, as when the
+// file is closed.
+void editor_index_cancel(void) {
+  if (E.index == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&E.index->lock);
+  E.index->cancel = 1;
+  pthread_mutex_unlock(&E.index->lock);
+  editor_index_finish();
+}
+
+int editor_index_progress(void) {
+  if (E.index == NULL) {
+    return 100;
+  }
+  return E.index->indexed * 100 / E.index->size;
+}
@@ -0,0 +1,248 @@
+#include "kilo.h"
+
+/*** input ***/
+
+char *editor_prompt(char *prompt, void (*callback)(char *, int)) {
+  size_t buffer_size = 128;
+  char *buffer = malloc(buffer_size);
+
+  size_t buffer_length = 0;
+  buffer[0] = '\0';
+
+  if (E.macro.replaying) {
+    editor_macro_flush_highlight();
+  }
+  while (1) {
+    editor_set_status_message(prompt, buffer);
+    editor_refresh_screen();
+
+    int c = editor_read_key();
+    if (c == DEL_KEY || c == CTRL_KEY('h') || c == BACKSPACE) {
+      if (buffer_length != 0) {
+        buffer[--buffer_length] = '\0';
+      }
+    }
+    if (c == '\x1b') {
+      editor_set_status_message("");
+      if (callback) {
+        callback(buffer, c);
+      }
+      free(buffer);
+      return NULL;
+    } else if (c == '\r') {
+      if (buffer_length != 0) {
+        editor_set_status_message("");
+        if (callback) {
+          callback(buffer, c);
+        }
+        return buffer;
+      }
+    } else if (!iscntrl(c) && c < 128) {
+      if (buffer_length == buffer_size - 1) {
+        buffer_size *= 2;
+        buffer = realloc(buffer, buffer_size);
+      }
+      buffer[buffer_length++] = c;
+      buffer[buffer_length] = '\0';
+    }
+
+    if (callback) {
+      callback(buffer, c);
+    }
+  }
+}
+
+void editor_move_cursor(int key) {
+  // Moving down or past the end of a row may step onto the next row.
+  editor_wait_rows(E.cursor_y + 2);
+  editor_row *row =
+    (E.cursor_y >= E.num_rows) ? NULL : editor_row_at(E.cursor_y);
+
+  switch (key) {
+    case ARROW_LEFT:
+      if (E.cursor_x != 0) {
+        E.cursor_x = editor_row_prev_char(row, E.cursor_x);
+      } else if (E.cursor_y > 0) {
+        E.cursor_y--;
+        E.cursor_x = editor_row_at(E.cursor_y)->size;
+      }
+      break;
+    case ARROW_RIGHT:
+      if (row && E.cursor_x < row->size) {
+        E.cursor_x = editor_row_next_char(row, E.cursor_x);
+      } else if (row && E.cursor_x == row->size) {
+        E.cursor_y++;
+        E.cursor_x = 0;
+      }
+      break;
+    case ARROW_UP:
+      if (E.cursor_y != 0) {
+        E.cursor_y--;
+      }
+      break;
+    case ARROW_DOWN:
+      if (E.cursor_y != E.num_rows) {
+        E.cursor_y++;
+      }
+      break;
+  }
+
+  row = (E.cursor_y >= E.num_rows) ? NULL : editor_row_at(E.cursor_y);
+  int row_length = row ? row->size : 0;
+  if (E.cursor_x > row_length) {
+    E.cursor_x = row_length;
+  }
+  // Moving up or down can land inside a character.
+  while (row && row->chars && E.cursor_x > 0 && E.cursor_x < row_length &&
+         (row->chars[E.cursor_x] & 0xc0) == 0x80) {
+    E.cursor_x--;
+  }
+}
+
+void editor_process_keypress(void) {
+  static int quit_times = KILO_QUIT_TIMES;
+
+  int c = editor_read_key();
+
+  switch (c) {
+    case '\r':
+      if (E.grep) {
+        editor_grep_open();
+        break;
+      }
+      editor_insert_newline();
+      break;
+
+    case CTRL_KEY('q'):
+      // Unsaved changes stay in a detached buffer, so there is no warning.
+      if (E.terminal->detach) {
+        E.terminal->detach();
+        break;
+      }
+      if (E.dirty && quit_times > 0) {
+        editor_set_status_message(
+          "WARNING!!! File has unsaved changes. "
+          "Press Ctrl-Q %d more times to quit.",
+          quit_times);
+        quit_times--;
+        editor_stats_processed();
+        return;
+      }
+      editor_write("\x1b[2J", 4);
+      editor_write("\x1b[H", 3);
+      exit(0);
+      break;
+
+    case CTRL_KEY('s'):
+      editor_save();
+      break;
+
+    case ARROW_UP:
+    case ARROW_DOWN:
+    case ARROW_LEFT:
+    case ARROW_RIGHT:
+      editor_move_cursor(c);
+      break;
+    case HOME_KEY:
+      E.cursor_x = 0;
+      break;
+    case END_KEY:
+      if (E.cursor_y < E.num_rows) {
+        E.cursor_x = editor_row_at(E.cursor_y)->size;
+      }
+      break;
+
+    case CTRL_KEY('f'):
+      editor_find();
+      break;
+
+    case CTRL_KEY('g'):
+      editor_cache_usage();
+      break;
+
+    case CTRL_KEY('r'):
+      editor_replace();
+      break;
+
+    case CTRL_KEY('z'):
+      editor_undo();
+      break;
+
+    case CTRL_KEY('k'):
+      editor_macro_toggle();
+      break;
+
+    case CTRL_KEY('e'):
+      editor_macro_run();
+      break;
+
+    case CTRL_KEY('o'):
+      editor_pane_split('h');
+      break;
+
+    case CTRL_KEY('v'):
+      editor_pane_split('v');
+      break;
+
+    case CTRL_KEY('w'):
+      editor_pane_cycle();
+      break;
+
+    case CTRL_KEY('x'):
+      editor_pane_close();
+      break;
+
+    case CTRL_KEY('t'):
+      editor_wrap_toggle();
+      break;
+
+    case CTRL_KEY('p'):
+      editor_grep();
+      break;
+
+    case BACKSPACE:
+    case CTRL_KEY('h'):
+    case DEL_KEY:
+      if (c == DEL_KEY) {
+        editor_move_cursor(ARROW_RIGHT);
+      }
+
+      editor_del_char();
+      break;
+
+    case PAGE_UP:
+    case PAGE_DOWN:
+      if (editor_wrap_enabled()) {
+        editor_wrap_page(c);
+        break;
+      }
+      {
+        if (c == PAGE_UP) {
+          E.cursor_y = E.row_offset;
+        } else if (c == PAGE_DOWN) {
+          E.cursor_y = E.row_offset + E.screen_rows - 1;
+          editor_wait_rows(E.cursor_y + 1);
+          if (E.cursor_y > E.num_rows) {
+            E.cursor_y = E.num_rows;
+          }
+        }
+
+        int times = E.screen_rows;
+        while (times--) {
+          editor_move_cursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
+        }
+      }
+      break;
+
+    case CTRL_KEY('l'):
+    case '\x1b':
+      break;
+
+    default:
+      editor_insert_char(c);
+      break;
+  }
+
+  quit_times = KILO_QUIT_TIMES;
+  editor_stats_processed();
+}
@@ -0,0 +1,1138 @@
+#ifndef KILO_H
+#define KILO_H
+
+/*** includes ***/
+
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*** defines ***/
+
+#define KILO_VERSION "0.0.1"
+#define KILO_TAB_STOP 8
+#define KILO_QUIT_TIMES 3
+#define KILO_ROW_INLINE 64
+#define KILO_ARENA_CHUNK (1 << 20)
+#define KILO_STATS_WINDOW 256
+#define KILO_TRACE_RING (1 << 16)
+#define KILO_HIGHLIGHT_BATCH 4096
+#define KILO_LOAD_BATCH (1 << 20)
+#define KILO_INDEX_BATCH (4 << 20)
+#define KILO_VIEW_MEMORY (64 << 20)
+#define KILO_VIEW_MEMORY_MIN (16 << 20)
+#define KILO_VIEW_SCAN (1 << 20)
+#define KILO_VIEW_LINE (16 << 10)
+#define KILO_VIEW_SLOTS 4096
+#define KILO_FOLLOW_BATCH (256 << 10)
+#define KILO_FOLLOW_BUDGET 0.02
+#define KILO_WRAP_BUDGET 0.02
+#define KILO_GREP_LINE 256
+#define KILO_GREP_BLOCK (1 << 20)
+#define KILO_GREP_BINARY 8192
+#define KILO_CACHE_MEMORY (64 << 20)
+#define KILO_CHUNK_ROW (64 << 10)
+#define KILO_CHUNK_SIZE 4096
+#define KILO_CHUNK_FILL 3072
+#define KILO_HIGHLIGHT_SLACK 64
+#define KILO_SYNTAX_FILE ".kilo-syntax"
+#define KILO_SOCKET_NAME "kilo.sock"
+
+#define CTRL_KEY(k) ((k) & 0x1f)
+
+enum editor_key {
+  BACKSPACE = 127,
+  ARROW_LEFT = 1000,
+  ARROW_RIGHT,
+  ARROW_UP,
+  ARROW_DOWN,
+  DEL_KEY,
+  HOME_KEY,
+  END_KEY,
+  PAGE_UP,
+  PAGE_DOWN
+};
+
+enum editor_highlight {
+  HL_NORMAL = 0,
+  HL_COMMENT,
+  HL_MLCOMMENT,
+  HL_KEYWORD1,
+  HL_KEYWORD2,
+  HL_STRING,
+  HL_NUMBER,
+  HL_MATCH
+};
+
+// Building with KILO_TRACE (make TRACE=1) records a span for every
+// TRACE_SCOPE from its declaration to the end of the enclosing block, and
+// writes them as Chrome trace_event JSON to $KILO_TRACE_FILE (default
+// kilo-trace.json) at exit. Without it the macros compile to nothing.
+#ifdef KILO_TRACE
+#define TRACE_INIT() editor_trace_init()
+#define TRACE_SCOPE(name) \
+  struct editor_trace_scope trace_scope_ \
+    __attribute__((cleanup(editor_trace_end))) = editor_trace_begin(name)
+#else
+#define TRACE_INIT()
+#define TRACE_SCOPE(name)
+#endif
+
+#define HL_HIGHLIGHT_NUMBERS (1<<0)
+#define HL_HIGHLIGHT_STRINGS (1<<1)
+
+#define LEX_SEPARATOR (1<<0)
+#define LEX_DIGIT (1<<1)
+#define LEX_NUMBER (1<<2)
+#define LEX_QUOTE (1<<3)
+#define LEX_COMMENT (1<<4)
+#define LEX_KEYWORD (1<<5)
+
+enum editor_token_kind {
+  TOKEN_LINE_COMMENT,
+  TOKEN_BLOCK_COMMENT,
+  TOKEN_KEYWORD1,
+  TOKEN_KEYWORD2
+};
+
+/*** data ***/
+
+// A syntax as the highlighter runs it. classes holds the LEX_ flags of
+// every byte. Comment openers and keywords are tokens, numbered in the order
+// they take precedence, and are matched by walking a trie kept as a
+// transition table: one row of num_columns per state, one column per byte
+// that appears in any token, and column 0 for all other bytes. State 0 is
+// the root, which no transition leads back to, so moving to it means no
+// token matches. accept is the token ending in each state, or -1.
+struct editor_lexer {
+  unsigned char classes[256];
+  unsigned char columns[256];
+  int num_columns;
+  int num_states;
+  int state_capacity;
+  int *next;
+  int *accept;
+  int num_tokens;
+  unsigned char *kinds;
+  char *block_end;
+  int block_end_len;
+};
+
+// quotes and number_chars fall back to "\"'" and "." when NULL. lexer is
+// compiled from the rest when the syntax is first selected.
+struct editor_syntax {
+  char *file_type;
+  char **file_match;
+  char **keywords;
+  char *single_line_comment_start;
+  char *multiline_comment_start;
+  char *multiline_comment_end;
+  int flags;
+  char *quotes;
+  char *number_chars;
+  struct editor_lexer *lexer;
+};
+
+struct editor_tab_stop {
+  int cursor_x;
+  int render_x;
+};
+
+// count characters in a row's render that take size bytes and width screen
+// columns each, starting at render byte at and screen column column. Only
+// characters that are not one byte wide on screen get a run: UTF-8
+// sequences, and bytes that are not valid UTF-8, which have valid clear and
+// draw as a placeholder.
+struct editor_glyph_run {
+  int at;
+  int column;
+  int count;
+  unsigned char size;
+  unsigned char width;
+  unsigned char valid;
+};
+
+// A highlight span starts at a render column and runs until the next span
+// starts, or to the end of the render for the last one.
+struct editor_hl_span {
+  int start;
+  unsigned char highlight;
+};
+
+// Where the highlighter stands between two characters, which is all it
+// needs to carry on from there.
+struct editor_highlight_state {
+  int in_comment;
+  int in_string;
+  int prev_sep;
+  int prev_number;
+  int line_comment;
+};
+
+// A piece of a long row, holding size of its KILO_CHUNK_SIZE bytes of data.
+// It starts at render column render_x and takes up width columns. skip and
+// state are its highlight checkpoint: scanning resumes skip bytes into the
+// chunk in state, where skip lies past the start when a token runs over from
+// the chunks before.
+struct editor_chunk {
+  char *data;
+  int size;
+  int tabs;
+  int render_x;
+  int width;
+  int skip;
+  struct editor_highlight_state state;
+};
+
+// The chunks of a long row. Chunks render_from to render_to were edited
+// since render columns were last laid out, and highlight_from to
+// highlight_to since checkpoints were last taken; each range is empty while
+// from is past to. The window is what editor_chunks_window last rendered.
+struct editor_chunks {
+  struct editor_chunk *chunk;
+  int num_chunks;
+  int capacity;
+  int width;
+  int end_in_comment;
+  int render_from;
+  int render_to;
+  int highlight_from;
+  int highlight_to;
+  int window_valid;
+  int window_start;
+  int window_cols;
+};
+
+// chars live in one block of capacity bytes. Short rows keep that block in
+// inline_data, longer ones in a single heap allocation. Because inline rows
+// point into themselves, editor_row_bind must run whenever a row is moved.
+// Rows read by editor_open get their block and spans from the load arena
+// instead and only move to the heap once an edit needs more room.
+//
+// Highlighting is stored run-length encoded. A row with no spans is all
+// HL_NORMAL.
+//
+// render_size and the spans count bytes of render, which are also screen
+// columns except where the row has glyph runs.
+//
+// A row longer than KILO_CHUNK_ROW keeps its chars in chunks instead and has
+// no chars pointer. Its render, spans and render_size only cover the window
+// of columns on screen, which starts at render_start.
+typedef struct editor_row {
+  int idx;
+  int size;
+  int render_size;
+  int capacity;
+  char *chars;
+  char *render;
+  int num_hl;
+  int hl_capacity;
+  int hl_in_arena;
+  struct editor_hl_span *hl;
+  int hl_open_comment;
+  int num_tabs;
+  int tab_capacity;
+  struct editor_tab_stop *tab_stops;
+  int render_capacity;
+  char *render_buffer;
+  char *block;
+  int in_arena;
+  int evicted;
+  unsigned int last_use;
+  int render_start;
+  struct editor_chunks *chunks;
+  int num_glyph_runs;
+  int glyph_capacity;
+  struct editor_glyph_run *glyph_runs;
+  char inline_data[KILO_ROW_INLINE];
+} editor_row;
+
+struct editor_arena_chunk {
+  struct editor_arena_chunk *next;
+  size_t used;
+  size_t size;
+  char data[];
+};
+
+// The editor core reaches the outside world only through this interface, so
+// it runs the same against a real tty or a scripted one. A terminal with
+// detach set shares its buffers with later sessions, and Ctrl-Q calls it
+// instead of quitting.
+struct editor_terminal {
+  int (*read_key)(void);
+  void (*write)(const char *buffer, int length);
+  int (*get_window_size)(int *rows, int *cols);
+  void (*detach)(void);
+};
+
+struct editor_trace_scope {
+  const char *name;
+  double begin;
+};
+
+struct editor_frame_stats {
+  double time;
+  double input_to_paint;
+  double process;
+  double draw;
+  double write;
+  long bytes;
+  long allocations;
+};
+
+// Timing collected in stats mode. A key read by editor_read_key stays
+// pending until the next frame has been written, which closes its
+// input-to-paint latency. The last KILO_STATS_WINDOW latencies feed the
+// status bar and every frame is kept for the dump written at exit.
+struct editor_stats {
+  int enabled;
+  char *dump_path;
+  double start;
+  double key_time;
+  int key_pending;
+  double process;
+  double frame_start;
+  double draw_end;
+  long last_allocations;
+  double latency[KILO_STATS_WINDOW];
+  int num_latency;
+  int next_latency;
+  struct editor_frame_stats *frames;
+  int num_frames;
+  int frame_capacity;
+};
+
+// Rows for a stretch of the file, built by the background indexer and
+// waiting for the main thread to append them to E.row. in_comment is the
+// comment state they were highlighted as starting in.
+struct editor_row_batch {
+  struct editor_row_batch *next;
+  editor_row *rows;
+  int num_rows;
+  int in_comment;
+  size_t end;
+  struct editor_arena_chunk *arena;
+  struct editor_arena_chunk *hl_arena;
+};
+
+// State shared with the background indexer. data, size and the batch queue
+// belong to both threads and are guarded by lock; offset, in_comment and
+// syntax are only read by the indexer, indexed only by the main thread. The
+// indexer keeps to its own copy of the syntax, since E can be swapped for
+// another buffer's while it runs.
+struct editor_index {
+  char *data;
+  size_t size;
+  size_t offset;
+  size_t indexed;
+  int in_comment;
+  struct editor_syntax *syntax;
+  int done;
+  int cancel;
+  struct editor_row_batch *head;
+  struct editor_row_batch *tail;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  pthread_t thread;
+};
+
+// A decoded row of a read-only view, with the file offsets of its line and
+// the next one.
+struct editor_view_slot {
+  long line;
+  off_t offset;
+  off_t next;
+  long last_use;
+  size_t bytes;
+  editor_row row;
+};
+
+// A file too big to load, read from disk on demand. The marks, stride and
+// the scanner's counts are shared with the scanner thread and guarded by
+// lock; everything else belongs to the main thread.
+struct editor_view {
+  int fd;
+  off_t size;
+  off_t *marks;
+  long num_marks;
+  long mark_capacity;
+  size_t mark_budget;
+  long stride;
+  long newlines;
+  long lines;
+  off_t scanned;
+  int done;
+  int cancel;
+  struct editor_view_slot *slots;
+  int num_slots;
+  size_t cache_bytes;
+  size_t cache_budget;
+  long clock;
+  char *buffer;
+  char *search;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  pthread_t thread;
+};
+
+// A file followed for appended lines. offset is where the next unread
+// line starts.
+struct editor_follow {
+  char *filename;
+  int fd;
+  ino_t inode;
+  off_t offset;
+  int inotify_fd;
+  int watch;
+  int pending;
+  int rotated;
+  int trim;
+  char *buffer;
+};
+
+// The chars a replace-all overwrote in one row.
+struct editor_undo_row {
+  int row;
+  int size;
+  char *chars;
+};
+
+// A replace-all, undone as a whole. Rows are in ascending order.
+struct editor_undo {
+  struct editor_undo_row *rows;
+  int num_rows;
+  long count;
+};
+
+// One thread's share of a replace-all or of undoing one. Without a query,
+// the job puts back the undo rows it is given instead.
+struct editor_replace_job {
+  editor_row *rows;
+  int start;
+  int end;
+  const char *query;
+  const char *with;
+  struct editor_undo_row *undo;
+  int num_undo;
+  int undo_capacity;
+  long count;
+  int in_comment;
+  pthread_t thread;
+};
+
+// Keys recorded as editor_read_key hands them over. While replaying, keys
+// come from here instead, and rows edited are only highlighted once the
+// replay is over: highlight_from to highlight_to, empty while from is past
+// to.
+struct editor_macro {
+  int recording;
+  int replaying;
+  int *keys;
+  int num_keys;
+  int capacity;
+  int next;
+  int highlight_from;
+  int highlight_to;
+};
+
+// Panes show the buffer through cursors and scroll positions of their own,
+// which the active pane keeps in E instead. They form a tree in which a
+// split pane divides its area between first and second, stacked ('h') or
+// side by side ('v'), and only leaves show the buffer. A pane takes up
+// height lines of width columns from top and left. For a leaf the last of
+// them is its status bar, leaving rows lines of cols columns for text.
+// drawn holds the file row last drawn on each line, -1 for none, and
+// damaged marks lines whose row has changed since.
+struct editor_pane {
+  int split;
+  struct editor_pane *parent;
+  struct editor_pane *first;
+  struct editor_pane *second;
+  int top;
+  int left;
+  int height;
+  int width;
+  int rows;
+  int cols;
+  int cursor_x;
+  int cursor_y;
+  int render_x;
+  int row_offset;
+  int col_offset;
+  int *drawn;
+  unsigned char *damaged;
+};
+
+// The panes of a screen window_rows by window_cols. full asks the next
+// frame to clear the screen and draw every pane whole.
+struct editor_panes {
+  struct editor_pane *root;
+  struct editor_pane *active;
+  int window_rows;
+  int window_cols;
+  int full;
+};
+
+// Soft wrap. lines holds how many screen lines each row takes at width
+// columns, as of when it was last measured at widths, and tree is a Fenwick
+// tree over lines, out of date for rows from stale on. Rows from next on may
+// still be measured at another width. The top of the screen is line
+// line_offset of row row_offset, and cursor_y and cursor_x are where the
+// cursor is drawn. starts is scratch for the line starts of one row.
+struct editor_wrap {
+  int width;
+  int *lines;
+  int *widths;
+  int *tree;
+  int num_rows;
+  int capacity;
+  int stale;
+  int next;
+  int line_offset;
+  int cursor_y;
+  int cursor_x;
+  int *starts;
+  int start_capacity;
+};
+
+// A directory to list or a file to search, for a project search.
+struct editor_grep_task {
+  char *path;
+  int is_dir;
+};
+
+// A worker's own tasks, tasks[head] to tasks[tail]. The owner takes from
+// the back and other workers steal from the front.
+struct editor_grep_queue {
+  struct editor_grep_task *tasks;
+  int head;
+  int tail;
+  int capacity;
+  pthread_mutex_t lock;
+};
+
+// A matching line as the row it becomes: its path, ":line:" and text.
+struct editor_grep_result {
+  char *text;
+  int length;
+  int path_length;
+  int line;
+};
+
+// Results found by a worker, waiting for the main thread to append them.
+struct editor_grep_batch {
+  struct editor_grep_batch *next;
+  struct editor_grep_result *results;
+  int num_results;
+  int capacity;
+};
+
+// A search thread. found is scratch for the entries of a directory, and
+// buffer for reading a file too small to map.
+struct editor_grep_worker {
+  struct editor_grep *grep;
+  int id;
+  pthread_t thread;
+  struct editor_grep_queue queue;
+  struct editor_grep_task *found;
+  int num_found;
+  int found_capacity;
+  char *buffer;
+  size_t capacity;
+  struct editor_grep_batch *batch;
+};
+
+// Where the result on row i of the results buffer points, matches[i].
+struct editor_grep_match {
+  int path_length;
+  int line;
+};
+
+// A project search. pending, pushes, files, cancel and the batch queue are
+// shared with the workers and guarded by lock; matches belong to the main
+// thread. pending counts tasks queued or running and pushes how many times
+// tasks were queued, which is what an idle worker waits on. finished is set
+// once the workers are gone.
+struct editor_grep {
+  char *query;
+  size_t query_len;
+  int rare;
+  char *title;
+  double start;
+  struct editor_grep_worker *workers;
+  int num_workers;
+  int pending;
+  long pushes;
+  long files;
+  int cancel;
+  int finished;
+  struct editor_grep_batch *head;
+  struct editor_grep_batch *tail;
+  struct editor_grep_match *matches;
+  int num_matches;
+  int match_capacity;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+};
+
+struct editor_config {
+  int cursor_x;
+  int cursor_y;
+  int render_x;
+  int row_offset;
+  int col_offset;
+  int screen_rows;
+  int screen_cols;
+  int num_rows;
+  int row_capacity;
+  editor_row *row;
+  struct editor_arena_chunk *arena;
+  struct editor_arena_chunk *hl_arena;
+  size_t cache_bytes;
+  size_t cache_budget;
+  unsigned int cache_clock;
+  int loading;
+  struct editor_index *index;
+  struct editor_view *view;
+  struct editor_follow *follow;
+  struct editor_undo *undo;
+  struct editor_panes *panes;
+  struct editor_wrap *wrap;
+  struct editor_grep *grep;
+  off_t file_size;
+  int dirty;
+  char *filename;
+  char status_msg[80];
+  time_t status_msg_time;
+  struct editor_syntax *syntax;
+  struct editor_terminal *terminal;
+  struct editor_stats stats;
+  struct editor_macro macro;
+};
+
+extern struct editor_config E;
+
+// A buffer kept by the server: all of E while it was open, found by the
+// absolute path clients ask for.
+struct editor_server_buffer {
+  char *path;
+  struct editor_config config;
+};
+
+// The server's socket and the one client attached to it, whose window is
+// rows by cols. client_fd is -1 while no client is attached and current is
+// -1 until a buffer is loaded.
+struct editor_server {
+  char *socket_path;
+  int listen_fd;
+  int client_fd;
+  int rows;
+  int cols;
+  struct editor_server_buffer *buffers;
+  int num_buffers;
+  int capacity;
+  int current;
+};
+
+struct append_buffer {
+  char *buffer;
+  int length;
+  int capacity;
+};
+
+#define APPEND_BUFFER_INIT {NULL, 0, 0}
+
+// Color escapes for every highlight class, built once by editor_init_sgr so
+// that drawing never has to format them.
+struct editor_sgr {
+  int color;
+  int length;
+  char seq[8];
+};
+
+extern struct editor_sgr editor_sgr[HL_MATCH + 1];
+
+extern struct editor_syntax HLDB[];
+extern struct editor_syntax **editor_loaded_syntax;
+extern int editor_num_loaded_syntax;
+
+/*** prototypes ***/
+
+// editor.c
+void die(const char *s);
+int editor_read_key(void);
+void editor_write(const char *buffer, int length);
+int editor_thread_count(void);
+void editor_idle(void);
+void editor_init_buffer(void);
+void init_editor(struct editor_terminal *terminal);
+
+// terminal.c
+void disable_raw_mode(void);
+void enable_raw_mode(void);
+int terminal_read_escape(int fd);
+int terminal_read_key(void);
+int get_cursor_position(int *rows, int *cols);
+int get_window_size(int *rows, int *cols);
+void terminal_write(const char *buffer, int length);
+
+extern struct editor_terminal terminal_tty;
+
+// server.c
+char *editor_socket_path(void);
+int editor_socket_check(const char *path);
+int editor_socket_trusted(int fd);
+int editor_socket_address(const char *path, struct sockaddr_un *address);
+int editor_write_all(int fd, const char *buffer, int length);
+void editor_server_detach(void);
+int editor_server_read_key(void);
+void editor_server_write(const char *buffer, int length);
+int editor_server_get_window_size(int *rows, int *cols);
+int editor_server_listen(char *path);
+int editor_server_switch(char *path);
+char *editor_server_handshake(int fd, int *rows, int *cols);
+void editor_server_attach(int fd);
+void editor_server_run(char *socket_path, char **files, int num_files);
+int editor_client_run(char *socket_path, char *filename);
+
+extern struct editor_server editor_server;
+extern struct editor_terminal terminal_socket;
+
+// syntax.c
+int is_separator(int c);
+unsigned char *editor_highlight_scratch(int size);
+void editor_row_store_highlight(
+  editor_row *row,
+  unsigned char *hl,
+  struct editor_arena_chunk **arena);
+void editor_row_set_highlight(editor_row *row, unsigned char *hl);
+void editor_row_get_highlight(editor_row *row, unsigned char *hl);
+int editor_row_find_span(editor_row *row, int at);
+int editor_highlight_scan(
+  struct editor_syntax *syntax,
+  const char *text,
+  int size,
+  int i,
+  int stop,
+  struct editor_highlight_state *state,
+  unsigned char *hl);
+int editor_highlight_row(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment,
+  unsigned char *hl);
+void editor_update_syntax(editor_row *row);
+int editor_syntax_to_color(int highlight);
+void editor_init_sgr(void);
+void editor_select_syntax_highlight(void);
+void *editor_highlight_worker(void *arg);
+unsigned char *editor_highlight_reserve(
+  unsigned char *hl,
+  int *capacity,
+  int size);
+int editor_row_highlight(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment,
+  unsigned char **hl,
+  int *hl_capacity,
+  struct editor_arena_chunk **arena);
+void editor_highlight_range(
+  struct editor_syntax *syntax,
+  editor_row *rows,
+  int num_rows,
+  int in_comment,
+  struct editor_arena_chunk **arena);
+void editor_highlight_rows(void);
+
+// buffer.c
+char *editor_arena_alloc(struct editor_arena_chunk **arena, size_t size);
+void editor_arena_adopt(
+  struct editor_arena_chunk **arena,
+  struct editor_arena_chunk *chunk);
+void editor_arena_free(struct editor_arena_chunk **arena);
+void editor_row_bind(editor_row *row);
+editor_row *editor_row_at(int at);
+int editor_read_only(void);
+int editor_grow_capacity(int capacity, int needed);
+void editor_row_reserve(editor_row *row, int capacity);
+int editor_row_cursor_x_to_render_x(editor_row *row, int cursor_x);
+int eidtor_row_render_x_to_cursor_x(editor_row *row, int render_x);
+void editor_row_render(editor_row *row);
+void editor_update_row(editor_row *row);
+void editor_row_init(editor_row *row, int at);
+void editor_row_table_insert(int at, editor_row *row);
+void editor_insert_row(int at, char *s, size_t len);
+void editor_row_load(
+  editor_row *row,
+  int at,
+  const char *s,
+  size_t len,
+  struct editor_arena_chunk **arena);
+void editor_load_row(char *s, size_t len);
+void editor_free_row(editor_row *row);
+void editor_del_row(int at);
+void editor_row_insert_char(editor_row *row, int at, int c);
+void editor_row_append_string(editor_row *row, char *s, size_t len);
+void editor_row_del_char(editor_row *row, int at);
+void editor_insert_char(int c);
+void editor_insert_newline(void);
+void editor_del_char(void);
+char *editor_rows_to_string(int *buffer_length);
+void editor_open(char *filename);
+void editor_close(void);
+void editor_save(void);
+int editor_count_lines(const char *p, const char *end);
+void *editor_count_worker(void *arg);
+void *editor_load_worker(void *arg);
+void editor_split_rows(
+  const char *data,
+  size_t size,
+  editor_row **rows,
+  int *num_rows,
+  int *capacity,
+  struct editor_arena_chunk **arena);
+void editor_load_buffer(const char *data, size_t size);
+void editor_append_rows(editor_row *rows, int num_rows);
+void editor_find_callback(char *query, int key);
+void editor_find(void);
+
+// index.c
+size_t editor_index_prefix(const char *data, size_t size);
+void *editor_index_worker(void *arg);
+void editor_index_start(char *data, size_t size, size_t offset);
+void editor_index_finish(void);
+void editor_index_stitch(struct editor_row_batch *batch);
+int editor_index_absorb(void);
+void editor_wait_rows(int rows);
+void editor_index_cancel(void);
+int editor_index_progress(void);
+
+// view.c
+int editor_view_needed(char *filename);
+void editor_view_add_mark(struct editor_view *view, long line, off_t offset);
+void *editor_view_scanner(void *arg);
+void editor_view_open(char *filename, size_t memory);
+void editor_view_close(void);
+int editor_view_absorb(void);
+void editor_view_wait(int rows);
+int editor_view_progress(void);
+off_t editor_view_skip(off_t offset, long count);
+size_t editor_view_row_bytes(editor_row *row);
+void editor_view_drop(struct editor_view_slot *slot);
+void editor_view_evict(void);
+struct editor_view_slot *editor_view_load(int line, off_t offset);
+struct editor_view_slot *editor_view_slot(int at);
+editor_row *editor_view_row(int at);
+char *editor_view_search_buffer(void);
+long editor_view_count_newlines(const char *p, const char *end);
+long editor_view_search_forward(const char *query, int from);
+long editor_view_search_backward(const char *query, int from);
+void editor_view_find_callback(char *query, int key);
+
+// follow.c
+void editor_follow_start(char *filename);
+void editor_follow_stop(void);
+void editor_follow_trim(void);
+void editor_follow_reopen(void);
+void editor_follow_truncated(void);
+void editor_follow_saved(off_t length);
+int editor_follow_read(void);
+int editor_follow_poll(void);
+
+// cache.c
+size_t editor_row_cache_bytes(editor_row *row);
+void editor_row_evict(editor_row *row);
+void editor_row_restore(editor_row *row);
+void editor_cache_recount(void);
+void editor_cache_compact(void);
+void editor_cache_trim(void);
+void editor_cache_usage(void);
+
+// lexer.c
+char **editor_words_append(char **words, const char *value, char *suffix);
+struct editor_syntax *editor_syntax_add(const char *file_type);
+char *editor_first_word(const char *value, const char **rest);
+void editor_syntax_set(
+  struct editor_syntax *syntax,
+  const char *key,
+  const char *value);
+int editor_syntax_load(const char *path);
+void editor_syntax_load_default(void);
+void editor_lexer_columns(struct editor_lexer *lexer, const char *token);
+int editor_lexer_add(struct editor_lexer *lexer, const char *token, int kind);
+struct editor_lexer *editor_syntax_compile(struct editor_syntax *syntax);
+void editor_lexer_free(struct editor_lexer *lexer);
+int editor_lexer_match(
+  struct editor_lexer *lexer,
+  const char *text,
+  int i,
+  int keywords,
+  int line,
+  int *end);
+
+// utf8.c
+int editor_utf8_decode(const char *s, int len, unsigned int *code_point);
+int editor_char_width(unsigned int code_point);
+int editor_ascii_prefix(const char *s, int len);
+void editor_row_add_glyph(
+  editor_row *row,
+  int at,
+  int column,
+  int size,
+  int width,
+  int valid);
+void editor_row_measure(editor_row *row);
+int editor_glyph_run_end(struct editor_glyph_run *run);
+int editor_row_find_glyph_run(editor_row *row, int at);
+int editor_row_render_to_column(editor_row *row, int at);
+int editor_row_column_to_render(editor_row *row, int column, int *pad);
+int editor_is_mark(const char *s, int len);
+int editor_row_next_char(editor_row *row, int cursor_x);
+int editor_row_prev_char(editor_row *row, int cursor_x);
+
+// chunk.c
+int editor_count_tabs(const char *s, int len);
+void editor_chunks_touch(struct editor_chunks *chunks, int from, int to);
+void editor_chunks_shift(int *from, int *to, int at, int delta, int last);
+void editor_chunks_open(struct editor_chunks *chunks, int at, int count);
+void editor_chunks_close(struct editor_chunks *chunks, int at);
+int editor_chunks_fill(
+  struct editor_chunks *chunks,
+  int at,
+  const char *s,
+  int len);
+void editor_chunks_make(editor_row *row, const char *s, int len);
+void editor_row_chunk(editor_row *row);
+void editor_chunks_free(editor_row *row);
+char *editor_chunks_copy(editor_row *row);
+int editor_chunks_find(editor_row *row, const char *query, int len);
+void editor_row_flatten(editor_row *row);
+int editor_chunks_locate(
+  struct editor_chunks *chunks,
+  int at,
+  int at_end,
+  int *offset);
+int editor_chunks_gather(
+  struct editor_chunks *chunks,
+  int k,
+  char *text,
+  int max);
+int editor_chunks_reach(struct editor_chunks *chunks, int k, int offset);
+void editor_chunks_insert(editor_row *row, int at, const char *s, int len);
+void editor_chunks_delete(editor_row *row, int at);
+int editor_chunk_columns(const char *s, int len, int render_x);
+void editor_chunks_render(editor_row *row);
+int editor_chunks_highlight(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment);
+int editor_chunks_find_column(struct editor_chunks *chunks, int render_x);
+void editor_chunks_window(editor_row *row);
+int editor_chunks_cursor_x_to_render_x(editor_row *row, int cursor_x);
+int editor_chunks_render_x_to_cursor_x(editor_row *row, int render_x);
+
+// replace.c
+char *editor_row_detach_chars(editor_row *row);
+void editor_row_rewrite(editor_row *row, const char *s, int len);
+char *editor_replace_find(
+  const char *p,
+  const char *end,
+  const char *query,
+  size_t query_len);
+int editor_replace_row(struct editor_replace_job *job, editor_row *row);
+void *editor_replace_worker(void *arg);
+void editor_run_replace_jobs(struct editor_replace_job *jobs, int num_jobs);
+struct editor_replace_job *editor_replace_jobs(int *num_jobs);
+long editor_replace_all(const char *query, const char *with);
+void editor_undo_clear(void);
+void editor_undo(void);
+void editor_replace(void);
+
+// macro.c
+void editor_macro_record_key(int c);
+int editor_macro_next_key(void);
+void editor_macro_defer_highlight(int at);
+void editor_macro_flush_highlight(void);
+void editor_macro_shift(int at, int delta);
+void editor_macro_toggle(void);
+void editor_macro_replay(int times);
+void editor_macro_run(void);
+
+// pane.c
+struct editor_pane *editor_pane_new(struct editor_pane *parent);
+void editor_pane_free(struct editor_pane *pane);
+void editor_pane_save(struct editor_pane *pane);
+void editor_pane_load(struct editor_pane *pane);
+void editor_pane_layout(
+  struct editor_pane *pane,
+  int top,
+  int left,
+  int height,
+  int width);
+struct editor_pane *editor_pane_first(struct editor_pane *pane);
+struct editor_pane *editor_pane_next(struct editor_pane *pane);
+void editor_panes_resize(int rows, int cols);
+void editor_panes_free(void);
+void editor_pane_split(int split);
+void editor_pane_close(void);
+void editor_pane_cycle(void);
+void editor_panes_touch(int at);
+void editor_panes_touch_all(void);
+void editor_panes_shift(int at, int delta);
+void editor_pane_draw(
+  struct editor_pane *pane,
+  struct append_buffer *append_buffer,
+  int full);
+void editor_pane_draw_separators(
+  struct editor_pane *pane,
+  struct append_buffer *append_buffer);
+void editor_panes_draw(struct append_buffer *append_buffer);
+
+// grep.c
+int editor_grep_rarest(const char *query, size_t len);
+const char *editor_grep_find(
+  struct editor_grep *grep,
+  const char *p,
+  const char *end);
+void editor_grep_push(
+  struct editor_grep_worker *worker,
+  char *path,
+  int is_dir);
+int editor_grep_take(
+  struct editor_grep_queue *queue,
+  int steal,
+  struct editor_grep_task *task);
+int editor_grep_next_task(
+  struct editor_grep_worker *worker,
+  struct editor_grep_task *task);
+void editor_grep_add_result(
+  struct editor_grep_worker *worker,
+  const char *path,
+  int line,
+  const char *text,
+  int length);
+void editor_grep_scan(
+  struct editor_grep_worker *worker,
+  const char *path,
+  const char *data,
+  size_t size,
+  int *line);
+void editor_grep_reserve(struct editor_grep_worker *worker, size_t size);
+void editor_grep_blocks(
+  struct editor_grep_worker *worker,
+  const char *path,
+  int fd);
+void editor_grep_file(struct editor_grep_worker *worker, const char *path);
+void editor_grep_dir(struct editor_grep_worker *worker, const char *path);
+void *editor_grep_worker(void *arg);
+void editor_grep_start(char *root, char *query);
+void editor_grep_free_batches(struct editor_grep_batch *batch);
+void editor_grep_finish(void);
+int editor_grep_absorb(void);
+void editor_grep_cancel(void);
+long editor_grep_files(void);
+void editor_grep(void);
+void editor_grep_open(void);
+
+// wrap.c
+int editor_wrap_breaks(editor_row *row, int width, int *starts);
+int editor_wrap_layout(int at);
+int editor_wrap_line_start(int at, int line);
+void editor_wrap_build(void);
+void editor_wrap_add(int at, int delta);
+int editor_wrap_prefix(int at);
+int editor_wrap_find(int line);
+void editor_wrap_reserve(int num_rows);
+void editor_wrap_measure(int at);
+void editor_wrap_refresh(int at);
+void editor_wrap_sync(void);
+void editor_wrap_update(editor_row *row);
+void editor_wrap_shift(int at, int delta);
+int editor_wrap_idle(void);
+int editor_wrap_progress(void);
+int editor_wrap_enabled(void);
+void editor_wrap_free(void);
+void editor_wrap_toggle(void);
+int editor_wrap_locate(int at, int lines, int column);
+void editor_wrap_scroll(void);
+void editor_wrap_page(int key);
+void editor_wrap_draw_rows(struct append_buffer *append_buffer);
+
+// output.c
+void append_buffer_append(
+  struct append_buffer *append_buffer,
+  const char *str,
+  int length);
+void append_buffer_free(struct append_buffer *append_buffer);
+void editor_scroll(void);
+int editor_draw_empty(struct append_buffer *append_buffer, int y);
+int editor_draw_row(struct append_buffer *append_buffer, int y);
+int editor_draw_columns(
+  struct append_buffer *append_buffer,
+  editor_row *row,
+  int col_offset,
+  int width);
+void editor_draw_rows(struct append_buffer *append_buffer);
+void editor_draw_status_bar(struct append_buffer* append_buffer);
+void editor_draw_message_bar(struct append_buffer *append_buffer);
+void editor_refresh_screen(void);
+void editor_set_status_message(const char *fmt, ...);
+
+// stats.c
+double editor_stats_now(void);
+void editor_stats_dump(void);
+void editor_stats_enable(char *dump_path);
+void editor_stats_key(void);
+void editor_stats_processed(void);
+void editor_stats_frame_start(void);
+void editor_stats_drawn(void);
+void editor_stats_written(long bytes);
+int editor_stats_compare(const void *a, const void *b);
+int editor_stats_format(char *buffer, int size);
+
+extern int editor_counting;
+extern long editor_allocations;
+
+// trace.c
+double editor_trace_now(void);
+struct editor_trace_scope editor_trace_begin(const char *name);
+void editor_trace_end(struct editor_trace_scope *scope);
+void editor_trace_dump(void);
+void editor_trace_init(void);
+
+// input.c
+char *editor_prompt(char *prompt, void (*callback)(char *, int));
+void editor_move_cursor(int key);
+void editor_process_keypress(void);
+
+#endif
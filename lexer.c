@@ -0,0 +1,425 @@
+#include "kilo.h"
+
+/*** syntax definitions ***/
+
+// Besides the built-in HLDB, syntax definitions are read at startup from
+// ~/.kilo-syntax, or the file given with --syntax=. Each one starts with the
+// file type in brackets, followed by key = value lines:
+//
+//   [python]
+//   match = .py .pyw SConstruct
+//   keywords = def class if elif else while for return import
+//   types = int str float bool list dict
+//   comment = #
+//   block_comment = """ """
+//   strings = " '
+//   numbers = yes
+//   number_chars = .xXabcdefABCDEF_
+//
+// Words in match that start with a dot are extensions, the rest are matched
+// anywhere in the file name. types are highlighted as the second keyword
+// class. A key given twice adds to its list. Lines starting with # are
+// ignored, and so is anything the editor does not understand.
+
+struct editor_syntax **editor_loaded_syntax = NULL;
+int editor_num_loaded_syntax = 0;
+
+// Appends the whitespace separated words of value to the NULL terminated
+// list words, each followed by suffix, and returns the list.
+char **editor_words_append(char **words, const char *value, char *suffix) {
+  int count = 0;
+  while (words && words[count]) {
+    count++;
+  }
+
+  const char *p = value;
+  while (*p) {
+    while (*p && isspace((unsigned char)*p)) {
+      p++;
+    }
+    const char *start = p;
+    while (*p && !isspace((unsigned char)*p)) {
+      p++;
+    }
+    if (p == start) {
+      break;
+    }
+
+    words = realloc(words, sizeof(char *) * (count + 2));
+    if (words == NULL) {
+      die("realloc");
+    }
+    int len = p - start;
+    words[count] = malloc(len + strlen(suffix) + 1);
+    if (words[count] == NULL) {
+      die("malloc");
+    }
+    memcpy(words[count], start, len);
+    strcpy(&words[count][len], suffix);
+    count++;
+    words[count] = NULL;
+  }
+  return words;
+}
+
+struct editor_syntax *editor_syntax_add(const char *file_type) {
+  struct editor_syntax *syntax = calloc(1, sizeof(struct editor_syntax));
+  if (syntax == NULL) {
+    die("calloc");
+  }
+  syntax->file_type = strdup(file_type);
+  syntax->file_match = calloc(1, sizeof(char *));
+  syntax->keywords = calloc(1, sizeof(char *));
+  if (syntax->file_type == NULL || syntax->file_match == NULL ||
+      syntax->keywords == NULL) {
+    die("calloc");
+  }
+
+  editor_loaded_syntax = realloc(
+    editor_loaded_syntax,
+    sizeof(struct editor_syntax *) * (editor_num_loaded_syntax + 1));
+  if (editor_loaded_syntax == NULL) {
+    die("realloc");
+  }
+  editor_loaded_syntax[editor_num_loaded_syntax++] = syntax;
+  return syntax;
+}
+
+// Returns the first word of value as a string of its own, or NULL if there
+// is none. *rest is set to what follows it.
+char *editor_first_word(const char *value, const char **rest) {
+  while (*value && isspace((unsigned char)*value)) {
+    value++;
+  }
+  const char *end = value;
+  while (*end && !isspace((unsigned char)*end)) {
+    end++;
+  }
+  *rest = end;
+  return end > value ? strndup(value, end - value) : NULL;
+}
+
+void editor_syntax_set(
+  struct editor_syntax *syntax,
+  const char *key,
+  const char *value) {
+  const char *rest;
+  if (!strcmp(key, "match")) {
+    syntax->file_match = editor_words_append(syntax->file_match, value, "");
+  } else if (!strcmp(key, "keywords")) {
+    syntax->keywords = editor_words_append(syntax->keywords, value, "");
+  } else if (!strcmp(key, "types")) {
+    syntax->keywords = editor_words_append(syntax->keywords, value, "|");
+  } else if (!strcmp(key, "comment")) {
+    free(syntax->single_line_comment_start);
+    syntax->single_line_comment_start = editor_first_word(value, &rest);
+  } else if (!strcmp(key, "block_comment")) {
+    free(syntax->multiline_comment_start);
+    free(syntax->multiline_comment_end);
+    syntax->multiline_comment_start = editor_first_word(value, &rest);
+    syntax->multiline_comment_end = editor_first_word(rest, &rest);
+  } else if (!strcmp(key, "strings")) {
+    // The quote characters are given as words, so '"' can be written alone.
+    char quotes[256];
+    int len = 0;
+    const char *p;
+    for (p = value; *p && len < (int)sizeof(quotes) - 1; p++) {
+      if (!isspace((unsigned char)*p)) {
+        quotes[len++] = *p;
+      }
+    }
+    quotes[len] = '\0';
+    free(syntax->quotes);
+    syntax->quotes = strdup(quotes);
+    if (len > 0) {
+      syntax->flags |= HL_HIGHLIGHT_STRINGS;
+    } else {
+      syntax->flags &= ~HL_HIGHLIGHT_STRINGS;
+    }
+  } else if (!strcmp(key, "numbers")) {
+    char *word = editor_first_word(value, &rest);
+    if (word && (!strcmp(word, "yes") || !strcmp(word, "true"))) {
+      syntax->flags |= HL_HIGHLIGHT_NUMBERS;
+    } else {
+      syntax->flags &= ~HL_HIGHLIGHT_NUMBERS;
+    }
+    free(word);
+  } else if (!strcmp(key, "number_chars")) {
+    free(syntax->number_chars);
+    syntax->number_chars = editor_first_word(value, &rest);
+  }
+}
+
+// Reads the syntax definitions in path, which take precedence over the
+// built-in ones. Returns -1 if the file cannot be read.
+int editor_syntax_load(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    return -1;
+  }
+
+  struct editor_syntax *syntax = NULL;
+  char *line = NULL;
+  size_t line_capacity = 0;
+  ssize_t line_length;
+  while ((line_length = getline(&line, &line_capacity, fp)) != -1) {
+    while (line_length > 0 && isspace((unsigned char)line[line_length - 1])) {
+      line[--line_length] = '\0';
+    }
+    char *p = line;
+    while (*p && isspace((unsigned char)*p)) {
+      p++;
+    }
+    if (*p == '\0' || *p == '#') {
+      continue;
+    }
+
+    if (*p == '[') {
+      char *end = strchr(p, ']');
+      if (end && end > p + 1) {
+        *end = '\0';
+        syntax = editor_syntax_add(p + 1);
+      }
+      continue;
+    }
+
+    char *equals = strchr(p, '=');
+    if (syntax == NULL || equals == NULL) {
+      continue;
+    }
+    char *key_end = equals;
+    while (key_end > p && isspace((unsigned char)key_end[-1])) {
+      key_end--;
+    }
+    *key_end = '\0';
+    editor_syntax_set(syntax, p, equals + 1);
+  }
+
+  free(line);
+  fclose(fp);
+  return 0;
+}
+
+void editor_syntax_load_default(void) {
+  char *home = getenv("HOME");
+  if (home == NULL) {
+    return;
+  }
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s", home, KILO_SYNTAX_FILE);
+  editor_syntax_load(path);
+}
+
+/*** lexer ***/
+
+// A syntax is compiled once into byte classes and a token trie, so that the
+// highlighter decides what to do with each byte with a table lookup rather
+// than a round of string compares. The line comment opener is token 0, the
+// block comment opener token 1, and keywords follow in the order they are
+// listed, so that the first one listed wins when two match.
+
+void editor_lexer_columns(struct editor_lexer *lexer, const char *token) {
+  if (lexer->num_columns == 0) {
+    lexer->num_columns = 1;
+  }
+  for (; *token; token++) {
+    if (lexer->columns[(unsigned char)*token] == 0) {
+      lexer->columns[(unsigned char)*token] = lexer->num_columns++;
+    }
+  }
+}
+
+// Adds token to the trie, whose columns must already cover its bytes, and
+// returns its index.
+int editor_lexer_add(struct editor_lexer *lexer, const char *token, int kind) {
+  int index = lexer->num_tokens++;
+  lexer->kinds = realloc(lexer->kinds, lexer->num_tokens);
+  if (lexer->kinds == NULL) {
+    die("realloc");
+  }
+  lexer->kinds[index] = kind;
+
+  int state = 0;
+  const char *p;
+  for (p = token; *p; p++) {
+    int *next = &lexer->next[
+      state * lexer->num_columns + lexer->columns[(unsigned char)*p]];
+    if (*next) {
+      state = *next;
+      continue;
+    }
+
+    if (lexer->num_states == lexer->state_capacity) {
+      lexer->state_capacity = editor_grow_capacity(
+        lexer->state_capacity,
+        lexer->num_states + 1);
+      lexer->next = realloc(
+        lexer->next,
+        sizeof(int) * lexer->state_capacity * lexer->num_columns);
+      lexer->accept = realloc(
+        lexer->accept,
+        sizeof(int) * lexer->state_capacity);
+      if (lexer->next == NULL || lexer->accept == NULL) {
+        die("realloc");
+      }
+      next = &lexer->next[
+        state * lexer->num_columns + lexer->columns[(unsigned char)*p]];
+    }
+    int added = lexer->num_states++;
+    memset(
+      &lexer->next[added * lexer->num_columns],
+      0,
+      sizeof(int) * lexer->num_columns);
+    lexer->accept[added] = -1;
+    *next = added;
+    state = added;
+  }
+
+  // A token listed twice keeps its first place.
+  if (state != 0 && lexer->accept[state] == -1) {
+    lexer->accept[state] = index;
+  }
+  return index;
+}
+
+struct editor_lexer *editor_syntax_compile(struct editor_syntax *syntax) {
+  TRACE_SCOPE("editor_syntax_compile");
+  struct editor_lexer *lexer = calloc(1, sizeof(struct editor_lexer));
+  if (lexer == NULL) {
+    die("calloc");
+  }
+
+  char *line = syntax->single_line_comment_start;
+  char *block = syntax->multiline_comment_end &&
+    syntax->multiline_comment_end[0] ?
+    syntax->multiline_comment_start : NULL;
+  if (line && line[0] == '\0') {
+    line = NULL;
+  }
+  if (block && block[0] == '\0') {
+    block = NULL;
+  }
+
+  int c;
+  for (c = 0; c < 256; c++) {
+    if (is_separator(c)) {
+      lexer->classes[c] |= LEX_SEPARATOR;
+    }
+  }
+  if (syntax->flags & HL_HIGHLIGHT_NUMBERS) {
+    for (c = '0'; c <= '9'; c++) {
+      lexer->classes[c] |= LEX_DIGIT;
+    }
+    const char *p = syntax->number_chars ? syntax->number_chars : ".";
+    for (; *p; p++) {
+      lexer->classes[(unsigned char)*p] |= LEX_NUMBER;
+    }
+  }
+  if (syntax->flags & HL_HIGHLIGHT_STRINGS) {
+    const char *p = syntax->quotes ? syntax->quotes : "\"'";
+    for (; *p; p++) {
+      lexer->classes[(unsigned char)*p] |= LEX_QUOTE;
+    }
+  }
+
+  // Every byte used by a token gets a column of its own.
+  const char *tokens[2] = {line ? line : "", block ? block : ""};
+  int j;
+  for (j = 0; j < 2; j++) {
+    if (tokens[j][0]) {
+      lexer->classes[(unsigned char)tokens[j][0]] |= LEX_COMMENT;
+    }
+    editor_lexer_columns(lexer, tokens[j]);
+  }
+  for (j = 0; syntax->keywords[j]; j++) {
+    if (syntax->keywords[j][0] && syntax->keywords[j][0] != '|') {
+      lexer->classes[(unsigned char)syntax->keywords[j][0]] |= LEX_KEYWORD;
+    }
+    editor_lexer_columns(lexer, syntax->keywords[j]);
+  }
+
+  lexer->state_capacity = 64;
+  lexer->next = calloc(lexer->state_capacity * lexer->num_columns, sizeof(int));
+  lexer->accept = malloc(sizeof(int) * lexer->state_capacity);
+  if (lexer->next == NULL || lexer->accept == NULL) {
+    die("calloc");
+  }
+  lexer->num_states = 1;
+  lexer->accept[0] = -1;
+
+  // Tokens 0 and 1 are always the comment openers, even when missing, so
+  // precedence is simply the token index.
+  editor_lexer_add(lexer, tokens[0], TOKEN_LINE_COMMENT);
+  editor_lexer_add(lexer, tokens[1], TOKEN_BLOCK_COMMENT);
+  for (j = 0; syntax->keywords[j]; j++) {
+    char *keyword = syntax->keywords[j];
+    int len = strlen(keyword);
+    int kind = TOKEN_KEYWORD1;
+    if (len > 0 && keyword[len - 1] == '|') {
+      kind = TOKEN_KEYWORD2;
+      len--;
+    }
+    if (len == 0) {
+      continue;
+    }
+    char *word = strndup(keyword, len);
+    if (word == NULL) {
+      die("malloc");
+    }
+    editor_lexer_add(lexer, word, kind);
+    free(word);
+  }
+
+  if (block) {
+    lexer->block_end = strdup(syntax->multiline_comment_end);
+    lexer->block_end_len = strlen(lexer->block_end);
+  }
+  return lexer;
+}
+
+void editor_lexer_free(struct editor_lexer *lexer) {
+  if (lexer == NULL) {
+    return;
+  }
+  free(lexer->next);
+  free(lexer->accept);
+  free(lexer->kinds);
+  free(lexer->block_end);
+  free(lexer);
+}
+
+// Walks the trie from text[i] and returns the token that takes precedence
+// among those matching there, or -1, with *end set to where it ends.
+// Keywords only match with keywords set and a separator after them, and the
+// line comment opener only with line set. text must end in a NUL, which no
+// token holds.
+int editor_lexer_match(
+  struct editor_lexer *lexer,
+  const char *text,
+  int i,
+  int keywords,
+  int line,
+  int *end) {
+  int best = -1;
+  int state = 0;
+  int p = i;
+  while ((state = lexer->next[
+      state * lexer->num_columns +
+      lexer->columns[(unsigned char)text[p]]]) != 0) {
+    p++;
+    int token = lexer->accept[state];
+    if (token < 0 || (best >= 0 && token > best)) {
+      continue;
+    }
+    int kind = lexer->kinds[token];
+    if (kind == TOKEN_LINE_COMMENT ? !line :
+        kind != TOKEN_BLOCK_COMMENT &&
+        (!keywords ||
+         !(lexer->classes[(unsigned char)text[p]] & LEX_SEPARATOR))) {
+      continue;
+    }
+    best = token;
+    *end = p;
+  }
+  return best;
+}
@@ -0,0 +1,142 @@
+#include "kilo.h"
+
+/*** macros ***/
+
+void editor_macro_record_key(int c) {
+  struct editor_macro *macro = &E.macro;
+  if (macro->num_keys == macro->capacity) {
+    macro->capacity = editor_grow_capacity(
+      macro->capacity,
+      macro->num_keys + 1);
+    macro->keys = realloc(macro->keys, sizeof(int) * macro->capacity);
+    if (macro->keys == NULL) {
+      die("realloc");
+    }
+  }
+  macro->keys[macro->num_keys++] = c;
+}
+
+// Hands out the next key of the macro being replayed. A prompt left open
+// when the keys run out is cancelled.
+int editor_macro_next_key(void) {
+  struct editor_macro *macro = &E.macro;
+  if (macro->next == macro->num_keys) {
+    return '\x1b';
+  }
+  return macro->keys[macro->next++];
+}
+
+// Called by editor_update_syntax while replaying, to highlight row at once
+// the replay is over.
+void editor_macro_defer_highlight(int at) {
+  if (at < E.macro.highlight_from) {
+    E.macro.highlight_from = at;
+  }
+  if (at > E.macro.highlight_to) {
+    E.macro.highlight_to = at;
+  }
+}
+
+// Highlights the rows edited so far in the replay. Called when it is over,
+// and before a prompt opens during it, since find and replace read the
+// highlight of rows the macro may have changed.
+void editor_macro_flush_highlight(void) {
+  struct editor_macro *macro = &E.macro;
+  int replaying = macro->replaying;
+  int from = macro->highlight_from;
+  int to = macro->highlight_to;
+  macro->replaying = 0;
+  macro->highlight_from = INT_MAX;
+  macro->highlight_to = -1;
+  int at;
+  for (at = from; at <= to && at < E.num_rows; at++) {
+    editor_update_syntax(&E.row[at]);
+  }
+  macro->replaying = replaying;
+}
+
+// Keeps the rows waiting for highlighting in place when a row is inserted
+// (delta 1) or deleted (delta -1) at at.
+void editor_macro_shift(int at, int delta) {
+  struct editor_macro *macro = &E.macro;
+  if (!macro->replaying || macro->highlight_from > macro->highlight_to) {
+    return;
+  }
+  if (at < macro->highlight_from ||
+      (delta > 0 && at == macro->highlight_from)) {
+    macro->highlight_from += delta;
+    macro->highlight_to += delta;
+  } else if (at <= macro->highlight_to) {
+    macro->highlight_to += delta;
+  }
+}
+
+void editor_macro_toggle(void) {
+  struct editor_macro *macro = &E.macro;
+  if (macro->recording) {
+    // The key that stopped recording is the last one recorded.
+    macro->num_keys--;
+    macro->recording = 0;
+    editor_set_status_message("Recorded a macro of %d keys", macro->num_keys);
+  } else {
+    macro->num_keys = 0;
+    macro->recording = 1;
+    editor_set_status_message("Recording macro, Ctrl-K to stop");
+  }
+}
+
+// Runs the macro times times in a row as one batch: the screen is not
+// redrawn and rows are not highlighted until every run is done.
+void editor_macro_replay(int times) {
+  TRACE_SCOPE("editor_macro_replay");
+  struct editor_macro *macro = &E.macro;
+  macro->replaying = 1;
+  macro->highlight_from = INT_MAX;
+  macro->highlight_to = -1;
+
+  int j;
+  for (j = 0; j < times; j++) {
+    macro->next = 0;
+    while (macro->next < macro->num_keys) {
+      editor_process_keypress();
+      // Keys like PAGE_DOWN move relative to the scroll position.
+      editor_scroll();
+    }
+  }
+
+  macro->replaying = 0;
+  editor_macro_flush_highlight();
+}
+
+void editor_macro_run(void) {
+  struct editor_macro *macro = &E.macro;
+  if (macro->recording) {
+    macro->num_keys--;
+    editor_set_status_message("Can't replay a macro while recording it");
+    return;
+  }
+  if (macro->num_keys == 0) {
+    editor_set_status_message("No macro recorded, Ctrl-K to start one");
+    return;
+  }
+
+  char *times = editor_prompt(
+    "Replay macro how many times: %s (ESC to cancel)",
+    NULL);
+  if (times == NULL) {
+    return;
+  }
+  int count = atoi(times);
+  free(times);
+  if (count <= 0) {
+    editor_set_status_message("Not a number of times");
+    return;
+  }
+
+  double start = editor_stats_now();
+  editor_macro_replay(count);
+  editor_set_status_message(
+    "Replayed macro %d times in %.2f s",
+    count,
+    editor_stats_now() - start);
+}
@@ -0,0 +1,373 @@
+#include "kilo.h"
+
+/*** append buffer ***/
+
+void append_buffer_append(
+  struct append_buffer *append_buffer,
+  const char *str,
+  int length) {
+  if (append_buffer->length + length > append_buffer->capacity) {
+    int capacity = append_buffer->capacity ? append_buffer->capacity : 4096;
+    while (capacity < append_buffer->length + length) {
+      capacity *= 2;
+    }
+    char *new = realloc(append_buffer->buffer, capacity);
+    if (new == NULL) {
+      return;
+    }
+    append_buffer->buffer = new;
+    append_buffer->capacity = capacity;
+  }
+
+  memcpy(&append_buffer->buffer[append_buffer->length], str, length);
+  append_buffer->length += length;
+}
+
+void append_buffer_free(struct append_buffer *append_buffer) {
+  free(append_buffer->buffer);
+}
+
+/*** output ***/
+
+void editor_scroll(void) {
+  if (editor_wrap_enabled()) {
+    editor_wrap_scroll();
+    return;
+  }
+  if (E.cursor_y < E.row_offset) {
+    E.row_offset = E.cursor_y;
+  }
+  if (E.cursor_y >= E.row_offset + E.screen_rows) {
+    E.row_offset = E.cursor_y - E.screen_rows + 1;
+  }
+  editor_wait_rows(E.row_offset + E.screen_rows);
+
+  // render_x and col_offset are screen columns.
+  E.render_x = E.cursor_x;
+  if (E.cursor_y < E.num_rows) {
+    editor_row *row = editor_row_at(E.cursor_y);
+    E.render_x = editor_row_render_to_column(
+      row,
+      editor_row_cursor_x_to_render_x(row, E.cursor_x));
+  }
+  if (E.render_x < E.col_offset) {
+    E.col_offset = E.render_x;
+  }
+  if (E.render_x >= E.col_offset + E.screen_cols) {
+    E.col_offset = E.render_x - E.screen_cols + 1;
+  }
+}
+
+// Draws line y of the screen past the end of the buffer, and returns how
+// many columns it took.
+int editor_draw_empty(struct append_buffer *append_buffer, int y) {
+  if (E.num_rows == 0 && y == E.screen_rows / 3) {
+    char welcome[80];
+    int welcome_length = snprintf(
+      welcome,
+      sizeof(welcome),
+      "Kilo editor -- version %s",
+      KILO_VERSION);
+    if (welcome_length > E.screen_cols) {
+      welcome_length = E.screen_cols;
+    }
+
+    int padding = (E.screen_cols - welcome_length) / 2;
+    if (padding) {
+      append_buffer_append(append_buffer, "~", 1);
+      padding--;
+    }
+
+    while (padding--) {
+      append_buffer_append(append_buffer, " ", 1);
+    }
+
+    append_buffer_append(append_buffer, welcome, welcome_length);
+    return (E.screen_cols - welcome_length) / 2 + welcome_length;
+  }
+  append_buffer_append(append_buffer, "~", 1);
+  return 1;
+}
+
+// Draws line y of the screen, without ending it, and returns how many
+// columns it took.
+int editor_draw_row(struct append_buffer *append_buffer, int y) {
+  int file_row = y + E.row_offset;
+  if (file_row >= E.num_rows) {
+    return editor_draw_empty(append_buffer, y);
+  }
+  return editor_draw_columns(
+    append_buffer,
+    editor_row_at(file_row),
+    E.col_offset,
+    E.screen_cols);
+}
+
+// Draws width columns of row from screen column col_offset on, or fewer
+// where the row ends, and returns how many it took.
+int editor_draw_columns(
+  struct append_buffer *append_buffer,
+  editor_row *row,
+  int col_offset,
+  int width) {
+  // Drawing walks render bytes from the first character on screen,
+  // counting columns as it goes, until a character does not fit.
+  int pad;
+  int j = editor_row_column_to_render(row, col_offset, &pad);
+  int column = pad;
+  for (; pad > 0; pad--) {
+    append_buffer_append(append_buffer, " ", 1);
+  }
+  int end = row->render_size;
+  int glyph = editor_row_find_glyph_run(row, j);
+  int full = 0;
+  int current_color = -1;
+  int span = editor_row_find_span(row, j);
+  while (j < end && !full) {
+    // Neighbouring spans that share a color are painted as one run.
+    struct editor_sgr *sgr = &editor_sgr[HL_NORMAL];
+    int run_end = end;
+    if (row->num_hl) {
+      sgr = &editor_sgr[row->hl[span].highlight];
+      span++;
+      while (span < row->num_hl && row->hl[span].start < end &&
+             editor_sgr[row->hl[span].highlight].color == sgr->color) {
+        span++;
+      }
+      if (span < row->num_hl && row->hl[span].start < end) {
+        run_end = row->hl[span].start;
+      }
+    }
+
+    if (sgr->color != current_color) {
+      append_buffer_append(append_buffer, sgr->seq, sgr->length);
+      current_color = sgr->color;
+    }
+
+    while (j < run_end) {
+      // A character that straddles run_end is drawn whole.
+      struct editor_glyph_run *run = NULL;
+      int printable = j;
+      while (printable < run_end) {
+        while (glyph < row->num_glyph_runs &&
+               editor_glyph_run_end(&row->glyph_runs[glyph]) <= printable) {
+          glyph++;
+        }
+        run = NULL;
+        if (glyph < row->num_glyph_runs &&
+            row->glyph_runs[glyph].at <= printable) {
+          run = &row->glyph_runs[glyph];
+          if (!run->valid) {
+            break;
+          }
+          if (column + run->width > width) {
+            full = 1;
+            break;
+          }
+          column += run->width;
+          printable += run->size;
+          continue;
+        }
+
+        // Up to the next run every byte is a column.
+        if (column == width) {
+          full = 1;
+          break;
+        }
+        int stop = run_end;
+        if (glyph < row->num_glyph_runs &&
+            row->glyph_runs[glyph].at < stop) {
+          stop = row->glyph_runs[glyph].at;
+        }
+        if (stop - printable > width - column) {
+          stop = printable + width - column;
+        }
+        int from = printable;
+        while (printable < stop &&
+               !iscntrl(
+                 (unsigned char)row->render[printable - row->render_start])) {
+          printable++;
+        }
+        column += printable - from;
+        if (printable < stop) {
+          break;
+        }
+      }
+      if (printable > j) {
+        append_buffer_append(
+          append_buffer,
+          &row->render[j - row->render_start],
+          printable - j);
+        j = printable;
+      }
+      if (j >= run_end || full) {
+        break;
+      }
+      if (column == width) {
+        full = 1;
+        break;
+      }
+
+      unsigned char c = row->render[j - row->render_start];
+      char control[16] = "\x1b[7m?\x1b[m";
+      int control_length = 8;
+      control[4] = (c <= 26) ? '@' + c : '?';
+      if (current_color != -1) {
+        memcpy(&control[control_length], sgr->seq, sgr->length);
+        control_length += sgr->length;
+      }
+      append_buffer_append(append_buffer, control, control_length);
+      j += run ? run->size : 1;
+      column++;
+    }
+  }
+  append_buffer_append(append_buffer, "\x1b[39m", 5);
+  return column;
+}
+
+void editor_draw_rows(struct append_buffer *append_buffer) {
+  int y;
+  for (y = 0; y < E.screen_rows; y++) {
+    editor_draw_row(append_buffer, y);
+    append_buffer_append(append_buffer, "\x1b[K", 3);
+    append_buffer_append(append_buffer, "\r\n", 2);
+  }
+}
+
+void editor_draw_status_bar(struct append_buffer* append_buffer) {
+  append_buffer_append(append_buffer, "\x1b[7m", 4);
+  char status[80];
+  char right_status[160];
+  char indexing[24] = "";
+  if (E.index) {
+    snprintf(
+      indexing,
+      sizeof(indexing),
+      "(indexing %d%%) ",
+      editor_index_progress());
+  } else if (E.view) {
+    snprintf(
+      indexing,
+      sizeof(indexing),
+      "(read-only, %d%%) ",
+      editor_view_progress());
+  } else if (E.grep && !E.grep->finished) {
+    snprintf(
+      indexing,
+      sizeof(indexing),
+      "(%ld files) ",
+      editor_grep_files());
+  } else if (editor_wrap_enabled() && E.wrap->next < E.wrap->num_rows) {
+    snprintf(
+      indexing,
+      sizeof(indexing),
+      "(wrapping %d%%) ",
+      editor_wrap_progress());
+  }
+  int len = snprintf(
+    status,
+    sizeof(status),
+    "%.20s - %d lines %s%s",
+    E.filename ? E.filename : E.grep ? E.grep->title : "[No Name]",
+    E.num_rows,
+    indexing,
+    E.dirty ? "(modified)" : "");
+  int right_len = editor_stats_format(right_status, sizeof(right_status));
+  right_len += snprintf(
+    &right_status[right_len],
+    sizeof(right_status) - right_len,
+    "%s | %d/%d",
+    E.syntax ? E.syntax->file_type : "no ft",
+    E.cursor_y + 1,
+    E.num_rows);
+  if (len > E.screen_cols) {
+    len = E.screen_cols;
+  }
+  append_buffer_append(append_buffer, status, len);
+  while (len < E.screen_cols) {
+    if (E.screen_cols - len == right_len) {
+      append_buffer_append(append_buffer, right_status, right_len);
+      break;
+    } else {
+      append_buffer_append(append_buffer, " ", 1);
+      len++;
+    }
+  }
+  append_buffer_append(append_buffer, "\x1b[m", 3);
+  append_buffer_append(append_buffer, "\r\n", 2);
+}
+
+void editor_draw_message_bar(struct append_buffer *append_buffer) {
+  append_buffer_append(append_buffer, "\x1b[K", 3);
+  int msg_len = strlen(E.status_msg);
+  if (msg_len > E.screen_cols) {
+    msg_len = E.screen_cols;
+  }
+  if (msg_len && time(NULL) - E.status_msg_time < 5) {
+    append_buffer_append(append_buffer, E.status_msg, msg_len);
+  }
+}
+
+void editor_refresh_screen(void) {
+  TRACE_SCOPE("editor_refresh_screen");
+  if (E.macro.replaying) {
+    return;
+  }
+  editor_stats_frame_start();
+  E.cache_clock++;
+  editor_index_absorb();
+  editor_view_absorb();
+  editor_grep_absorb();
+  editor_scroll();
+
+  struct append_buffer append_buffer = APPEND_BUFFER_INIT;
+
+  append_buffer_append(&append_buffer, "\x1b[?25l", 6);
+  if (E.panes) {
+    editor_panes_draw(&append_buffer);
+  } else {
+    append_buffer_append(&append_buffer, "\x1b[H", 3);
+
+    if (editor_wrap_enabled()) {
+      editor_wrap_draw_rows(&append_buffer);
+    } else {
+      editor_draw_rows(&append_buffer);
+    }
+    editor_stats_drawn();
+    editor_draw_status_bar(&append_buffer);
+    editor_draw_message_bar(&append_buffer);
+
+    int cursor_y = E.cursor_y - E.row_offset;
+    int cursor_x = E.render_x - E.col_offset;
+    if (editor_wrap_enabled()) {
+      cursor_y = E.wrap->cursor_y;
+      cursor_x = E.wrap->cursor_x;
+    }
+    char buffer[32];
+    snprintf(
+      buffer,
+      sizeof(buffer),
+      "\x1b[%d;%dH",
+      cursor_y + 1,
+      cursor_x + 1);
+    append_buffer_append(&append_buffer, buffer, strlen(buffer));
+  }
+
+  append_buffer_append(&append_buffer, "\x1b[?25h", 6);
+
+  editor_write(append_buffer.buffer, append_buffer.length);
+  editor_stats_written(append_buffer.length);
+  append_buffer_free(&append_buffer);
+
+  // Evicting only once the frame is out keeps it off the keystroke's
+  // latency, and every row on screen has just been fetched.
+  editor_cache_trim();
+}
+
+void editor_set_status_message(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(E.status_msg, sizeof(E.status_msg), fmt, ap);
+  va_end(ap);
+  E.status_msg_time = time(NULL);
+}
@@ -0,0 +1,433 @@
+#include "kilo.h"
+
+/*** panes ***/
+
+// A new leaf starts out where parent's cursor and scroll position are.
+struct editor_pane *editor_pane_new(struct editor_pane *parent) {
+  struct editor_pane *pane = calloc(1, sizeof(struct editor_pane));
+  if (pane == NULL) {
+    die("calloc");
+  }
+  pane->parent = parent;
+  if (parent) {
+    pane->cursor_x = parent->cursor_x;
+    pane->cursor_y = parent->cursor_y;
+    pane->render_x = parent->render_x;
+    pane->row_offset = parent->row_offset;
+    pane->col_offset = parent->col_offset;
+  }
+  return pane;
+}
+
+void editor_pane_free(struct editor_pane *pane) {
+  if (pane->split) {
+    editor_pane_free(pane->first);
+    editor_pane_free(pane->second);
+  }
+  free(pane->drawn);
+  free(pane->damaged);
+  free(pane);
+}
+
+void editor_pane_save(struct editor_pane *pane) {
+  pane->cursor_x = E.cursor_x;
+  pane->cursor_y = E.cursor_y;
+  pane->render_x = E.render_x;
+  pane->row_offset = E.row_offset;
+  pane->col_offset = E.col_offset;
+}
+
+// Makes pane the one E's cursor and scroll position belong to. Edits made
+// through other panes may have left its cursor past the end of the buffer.
+void editor_pane_load(struct editor_pane *pane) {
+  E.cursor_x = pane->cursor_x;
+  E.cursor_y = pane->cursor_y;
+  E.render_x = pane->render_x;
+  E.row_offset = pane->row_offset;
+  E.col_offset = pane->col_offset;
+  E.screen_rows = pane->rows;
+  E.screen_cols = pane->cols;
+
+  if (E.cursor_y > E.num_rows) {
+    E.cursor_y = E.num_rows;
+  }
+  int row_length =
+    E.cursor_y < E.num_rows ? editor_row_at(E.cursor_y)->size : 0;
+  if (E.cursor_x > row_length) {
+    E.cursor_x = row_length;
+  }
+}
+
+void editor_pane_layout(
+  struct editor_pane *pane,
+  int top,
+  int left,
+  int height,
+  int width) {
+  pane->top = top;
+  pane->left = left;
+  pane->height = height;
+  pane->width = width;
+
+  if (pane->split == 'h') {
+    int first = height / 2;
+    editor_pane_layout(pane->first, top, left, first, width);
+    editor_pane_layout(
+      pane->second,
+      top + first,
+      left,
+      height - first,
+      width);
+    return;
+  }
+  if (pane->split == 'v') {
+    // The column between the two is the separator.
+    int first = (width - 1) / 2;
+    editor_pane_layout(pane->first, top, left, height, first);
+    editor_pane_layout(
+      pane->second,
+      top,
+      left + first + 1,
+      height,
+      width - first - 1);
+    return;
+  }
+
+  pane->rows = height > 1 ? height - 1 : 0;
+  pane->cols = width;
+  pane->drawn = realloc(pane->drawn, sizeof(int) * (pane->rows + 1));
+  pane->damaged = realloc(pane->damaged, pane->rows + 1);
+  if (pane->drawn == NULL || pane->damaged == NULL) {
+    die("realloc");
+  }
+}
+
+struct editor_pane *editor_pane_first(struct editor_pane *pane) {
+  while (pane->split) {
+    pane = pane->first;
+  }
+  return pane;
+}
+
+// The leaf after pane, from left to right and top to bottom, or NULL for
+// the last one.
+struct editor_pane *editor_pane_next(struct editor_pane *pane) {
+  while (pane->parent && pane == pane->parent->second) {
+    pane = pane->parent;
+  }
+  if (pane->parent == NULL) {
+    return NULL;
+  }
+  return editor_pane_first(pane->parent->second);
+}
+
+void editor_panes_resize(int rows, int cols) {
+  struct editor_panes *panes = E.panes;
+  panes->window_rows = rows;
+  panes->window_cols = cols;
+  // The message bar keeps the last line.
+  editor_pane_layout(panes->root, 0, 0, rows - 1, cols);
+  panes->full = 1;
+  E.screen_rows = panes->active->rows;
+  E.screen_cols = panes->active->cols;
+}
+
+// Goes back to a single view of the whole screen, keeping E's cursor.
+void editor_panes_free(void) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    return;
+  }
+  E.screen_rows = panes->window_rows - 2;
+  E.screen_cols = panes->window_cols;
+  editor_pane_free(panes->root);
+  free(panes);
+  E.panes = NULL;
+}
+
+// Divides the active pane in two, stacked for 'h' and side by side for
+// 'v', and moves to the top or left one.
+void editor_pane_split(int split) {
+  if (E.panes == NULL) {
+    struct editor_panes *panes = calloc(1, sizeof(struct editor_panes));
+    if (panes == NULL) {
+      die("calloc");
+    }
+    panes->root = editor_pane_new(NULL);
+    panes->active = panes->root;
+    panes->window_rows = E.screen_rows + 2;
+    panes->window_cols = E.screen_cols;
+    E.panes = panes;
+    editor_pane_layout(
+      panes->root,
+      0,
+      0,
+      panes->window_rows - 1,
+      panes->window_cols);
+  }
+
+  struct editor_panes *panes = E.panes;
+  struct editor_pane *pane = panes->active;
+  if ((split == 'h' && pane->height < 4) ||
+      (split == 'v' && pane->width < 3)) {
+    editor_set_status_message("No room to split this pane");
+    if (!panes->root->split) {
+      editor_panes_free();
+    }
+    return;
+  }
+
+  editor_pane_save(pane);
+  pane->split = split;
+  pane->first = editor_pane_new(pane);
+  pane->second = editor_pane_new(pane);
+  free(pane->drawn);
+  free(pane->damaged);
+  pane->drawn = NULL;
+  pane->damaged = NULL;
+
+  panes->active = pane->first;
+  editor_panes_resize(panes->window_rows, panes->window_cols);
+  editor_pane_load(panes->active);
+}
+
+// Closes the active pane, giving its area to the pane it was split from.
+void editor_pane_close(void) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    editor_set_status_message("There is only one pane");
+    return;
+  }
+
+  struct editor_pane *pane = panes->active;
+  struct editor_pane *parent = pane->parent;
+  struct editor_pane *sibling =
+    parent->first == pane ? parent->second : parent->first;
+  editor_pane_free(pane);
+
+  sibling->parent = parent->parent;
+  if (parent->parent == NULL) {
+    panes->root = sibling;
+  } else if (parent->parent->first == parent) {
+    parent->parent->first = sibling;
+  } else {
+    parent->parent->second = sibling;
+  }
+  free(parent);
+
+  panes->active = editor_pane_first(sibling);
+  editor_panes_resize(panes->window_rows, panes->window_cols);
+  editor_pane_load(panes->active);
+  if (!panes->root->split) {
+    editor_panes_free();
+  }
+}
+
+void editor_pane_cycle(void) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    return;
+  }
+  editor_pane_save(panes->active);
+  struct editor_pane *next = editor_pane_next(panes->active);
+  panes->active = next ? next : editor_pane_first(panes->root);
+  editor_pane_load(panes->active);
+}
+
+/*** damage ***/
+
+// Row at changed. The active pane is drawn whole every frame; the others
+// only redraw it if they show it.
+void editor_panes_touch(int at) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    return;
+  }
+  struct editor_pane *pane;
+  for (pane = editor_pane_first(panes->root);
+       pane;
+       pane = editor_pane_next(pane)) {
+    int y = at - pane->row_offset;
+    if (pane != panes->active && y >= 0 && y < pane->rows) {
+      pane->damaged[y] = 1;
+    }
+  }
+}
+
+// Rows all over the buffer changed at once, as after replace-all, an undo
+// or a change of syntax, so every pane redraws what it shows.
+void editor_panes_touch_all(void) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    return;
+  }
+  struct editor_pane *pane;
+  for (pane = editor_pane_first(panes->root);
+       pane;
+       pane = editor_pane_next(pane)) {
+    memset(pane->damaged, 1, pane->rows);
+  }
+}
+
+// A row was inserted (delta 1) or deleted (delta -1) at at. Panes scrolled
+// past it move along so that they keep showing the same rows; panes that
+// show it redraw from there down.
+void editor_panes_shift(int at, int delta) {
+  struct editor_panes *panes = E.panes;
+  if (panes == NULL) {
+    return;
+  }
+  struct editor_pane *pane;
+  for (pane = editor_pane_first(panes->root);
+       pane;
+       pane = editor_pane_next(pane)) {
+    if (pane == panes->active) {
+      continue;
+    }
+    if (pane->cursor_y > at || (delta > 0 && pane->cursor_y == at)) {
+      pane->cursor_y += delta;
+    }
+    int y;
+    if (at < pane->row_offset) {
+      pane->row_offset += delta;
+      for (y = 0; y < pane->rows; y++) {
+        if (pane->drawn[y] != -1) {
+          pane->drawn[y] += delta;
+        }
+      }
+      continue;
+    }
+    for (y = at - pane->row_offset; y < pane->rows; y++) {
+      pane->damaged[y] = 1;
+    }
+  }
+}
+
+/*** output ***/
+
+// Draws the lines of pane that need it, or all of them when full is set,
+// and its status bar.
+void editor_pane_draw(
+  struct editor_pane *pane,
+  struct append_buffer *append_buffer,
+  int full) {
+  struct editor_pane saved;
+  editor_pane_save(&saved);
+  int screen_rows = E.screen_rows;
+  int screen_cols = E.screen_cols;
+  E.cursor_x = pane->cursor_x;
+  E.cursor_y = pane->cursor_y;
+  E.row_offset = pane->row_offset;
+  E.col_offset = pane->col_offset;
+  E.screen_rows = pane->rows;
+  E.screen_cols = pane->cols;
+
+  char position[32];
+  int y;
+  for (y = 0; y < pane->rows; y++) {
+    int file_row = pane->row_offset + y;
+    if (file_row >= E.num_rows) {
+      file_row = -1;
+    }
+    if (!full && !pane->damaged[y] && pane->drawn[y] == file_row) {
+      continue;
+    }
+    int length = snprintf(
+      position,
+      sizeof(position),
+      "\x1b[%d;%dH",
+      pane->top + y + 1,
+      pane->left + 1);
+    append_buffer_append(append_buffer, position, length);
+
+    int columns = editor_draw_row(append_buffer, y);
+    if (pane->left + pane->cols == E.panes->window_cols) {
+      append_buffer_append(append_buffer, "\x1b[K", 3);
+    } else {
+      for (; columns < pane->cols; columns++) {
+        append_buffer_append(append_buffer, " ", 1);
+      }
+    }
+    pane->drawn[y] = file_row;
+    pane->damaged[y] = 0;
+  }
+
+  int length = snprintf(
+    position,
+    sizeof(position),
+    "\x1b[%d;%dH",
+    pane->top + pane->rows + 1,
+    pane->left + 1);
+  append_buffer_append(append_buffer, position, length);
+  editor_draw_status_bar(append_buffer);
+
+  E.cursor_x = saved.cursor_x;
+  E.cursor_y = saved.cursor_y;
+  E.row_offset = saved.row_offset;
+  E.col_offset = saved.col_offset;
+  E.screen_rows = screen_rows;
+  E.screen_cols = screen_cols;
+}
+
+void editor_pane_draw_separators(
+  struct editor_pane *pane,
+  struct append_buffer *append_buffer) {
+  if (!pane->split) {
+    return;
+  }
+  if (pane->split == 'v') {
+    char separator[32];
+    int y;
+    for (y = 0; y < pane->height; y++) {
+      int length = snprintf(
+        separator,
+        sizeof(separator),
+        "\x1b[%d;%dH\x1b[7m|\x1b[m",
+        pane->top + y + 1,
+        pane->first->left + pane->first->width + 1);
+      append_buffer_append(append_buffer, separator, length);
+    }
+  }
+  editor_pane_draw_separators(pane->first, append_buffer);
+  editor_pane_draw_separators(pane->second, append_buffer);
+}
+
+void editor_panes_draw(struct append_buffer *append_buffer) {
+  struct editor_panes *panes = E.panes;
+  int full = panes->full;
+  if (full) {
+    append_buffer_append(append_buffer, "\x1b[2J", 4);
+    editor_pane_draw_separators(panes->root, append_buffer);
+    panes->full = 0;
+  }
+
+  editor_pane_save(panes->active);
+  struct editor_pane *pane;
+  for (pane = editor_pane_first(panes->root);
+       pane;
+       pane = editor_pane_next(pane)) {
+    editor_pane_draw(pane, append_buffer, full || pane == panes->active);
+  }
+  editor_stats_drawn();
+
+  char position[32];
+  int length = snprintf(
+    position,
+    sizeof(position),
+    "\x1b[%d;1H",
+    panes->window_rows);
+  append_buffer_append(append_buffer, position, length);
+  int screen_cols = E.screen_cols;
+  E.screen_cols = panes->window_cols;
+  editor_draw_message_bar(append_buffer);
+  E.screen_cols = screen_cols;
+
+  struct editor_pane *active = panes->active;
+  length = snprintf(
+    position,
+    sizeof(position),
+    "\x1b[%d;%dH",
+    active->top + (E.cursor_y - E.row_offset) + 1,
+    active->left + (E.render_x - E.col_offset) + 1);
+  append_buffer_append(append_buffer, position, length);
+}
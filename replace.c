@@ -0,0 +1,391 @@
+#include "kilo.h"
+
+/*** replace ***/
+
+// A replace-all rewrites each row holding the query in one pass, with no
+// per-character edits. The rows are cut into one range per thread, and each
+// thread rewrites, renders and rehighlights its rows, along with any row
+// below them whose comment state they changed. As in editor_highlight_range,
+// every range but the first assumes it starts in the comment state the row
+// above had before, and the ranges are stitched together afterwards. What
+// the rows held before is kept as a single undo unit, which any later edit
+// drops since its row numbers would no longer hold.
+
+// Hands the row's chars over as a heap string of their own, copying them
+// unless they already live in a heap block, and leaves the row empty.
+char *editor_row_detach_chars(editor_row *row) {
+  char *chars;
+  if (row->chunks) {
+    chars = editor_chunks_copy(row);
+    editor_chunks_free(row);
+  } else if (row->block && !row->in_arena) {
+    chars = row->block;
+  } else {
+    chars = malloc(row->size + 1);
+    if (chars == NULL) {
+      die("malloc");
+    }
+    memcpy(chars, row->chars, row->size + 1);
+  }
+  row->block = NULL;
+  row->in_arena = 0;
+  row->capacity = 0;
+  row->size = 0;
+  editor_row_bind(row);
+  return chars;
+}
+
+// Replaces the row's chars with len bytes of s and renders it again.
+void editor_row_rewrite(editor_row *row, const char *s, int len) {
+  if (row->chunks) {
+    editor_chunks_free(row);
+  }
+  if (!row->in_arena) {
+    free(row->block);
+  }
+  row->block = NULL;
+  row->in_arena = 0;
+  row->capacity = 0;
+  editor_row_bind(row);
+  editor_row_reserve(row, len + 1);
+  memcpy(row->chars, s, len);
+  row->chars[len] = '\0';
+  row->size = len;
+  editor_row_render(row);
+  row->evicted = 0;
+}
+
+// Returns the first occurrence of query in [p, end). memmem pays a setup
+// cost on every call that dwarfs the search itself on rows this short, so
+// candidates are found with memchr instead.
+char *editor_replace_find(
+  const char *p,
+  const char *end,
+  const char *query,
+  size_t query_len) {
+  while ((size_t)(end - p) >= query_len) {
+    p = memchr(p, query[0], end - p - query_len + 1);
+    if (p == NULL) {
+      return NULL;
+    }
+    if (!memcmp(p, query, query_len)) {
+      return (char *)p;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+// Replaces every occurrence of the job's query in row, and returns whether
+// there was any. A long row is searched in a flat copy of its chunks.
+int editor_replace_row(struct editor_replace_job *job, editor_row *row) {
+  size_t query_len = strlen(job->query);
+  size_t with_len = strlen(job->with);
+  char *flat = row->chunks ? editor_chunks_copy(row) : NULL;
+  char *chars = flat ? flat : row->chars;
+  char *end = chars + row->size;
+  char *match = editor_replace_find(chars, end, job->query, query_len);
+  if (match == NULL) {
+    free(flat);
+    return 0;
+  }
+
+  int count = 0;
+  while (match) {
+    count++;
+    match += query_len;
+    match = editor_replace_find(match, end, job->query, query_len);
+  }
+  free(flat);
+
+  if (job->num_undo == job->undo_capacity) {
+    job->undo_capacity = job->undo_capacity ? job->undo_capacity * 2 : 64;
+    job->undo = realloc(
+      job->undo,
+      sizeof(struct editor_undo_row) * job->undo_capacity);
+    if (job->undo == NULL) {
+      die("realloc");
+    }
+  }
+  struct editor_undo_row *undo = &job->undo[job->num_undo++];
+  undo->row = row->idx;
+  undo->size = row->size;
+  undo->chars = editor_row_detach_chars(row);
+
+  int size = undo->size + count * ((int)with_len - (int)query_len);
+  editor_row_reserve(row, size + 1);
+  char *p = undo->chars;
+  end = undo->chars + undo->size;
+  char *out = row->chars;
+  while ((match = editor_replace_find(p, end, job->query, query_len))) {
+    memcpy(out, p, match - p);
+    out += match - p;
+    memcpy(out, job->with, with_len);
+    out += with_len;
+    p = match + query_len;
+  }
+  memcpy(out, p, end - p);
+  row->size = size;
+  row->chars[size] = '\0';
+  editor_row_render(row);
+  row->evicted = 0;
+
+  job->count += count;
+  return 1;
+}
+
+void *editor_replace_worker(void *arg) {
+  TRACE_SCOPE("editor_replace_worker");
+  struct editor_replace_job *job = arg;
+  unsigned char *hl = NULL;
+  int hl_capacity = 0;
+  int next_undo = 0;
+
+  // in_comment is the state the next row starts in now, was_in_comment the
+  // one it was last highlighted with.
+  int in_comment = job->in_comment;
+  int was_in_comment = job->in_comment;
+  int j;
+  for (j = job->start; j < job->end; j++) {
+    editor_row *row = &job->rows[j];
+    int touched;
+    if (job->query) {
+      touched = editor_replace_row(job, row);
+    } else {
+      touched = next_undo < job->num_undo && job->undo[next_undo].row == j;
+      if (touched) {
+        struct editor_undo_row *undo = &job->undo[next_undo++];
+        editor_row_rewrite(row, undo->chars, undo->size);
+      }
+    }
+
+    int was_open_comment = row->hl_open_comment;
+    if (E.syntax && (touched || in_comment != was_in_comment)) {
+      if (row->evicted) {
+        editor_row_render(row);
+        row->evicted = 0;
+      }
+      row->hl_open_comment = editor_row_highlight(
+        E.syntax,
+        row,
+        in_comment,
+        &hl,
+        &hl_capacity,
+        NULL);
+    }
+    was_in_comment = was_open_comment;
+    in_comment = row->hl_open_comment;
+  }
+
+  free(hl);
+  return NULL;
+}
+
+void editor_run_replace_jobs(struct editor_replace_job *jobs, int num_jobs) {
+  int j;
+  for (j = 1; j < num_jobs; j++) {
+    if (pthread_create(
+        &jobs[j].thread,
+        NULL,
+        editor_replace_worker,
+        &jobs[j]) != 0) {
+      die("pthread_create");
+    }
+  }
+  editor_replace_worker(&jobs[0]);
+  for (j = 1; j < num_jobs; j++) {
+    pthread_join(jobs[j].thread, NULL);
+  }
+
+  if (E.syntax) {
+    unsigned char *hl = NULL;
+    int hl_capacity = 0;
+    for (j = 1; j < num_jobs; j++) {
+      int entry = E.row[jobs[j].start - 1].hl_open_comment;
+      int assumed = jobs[j].in_comment;
+      int at = jobs[j].start;
+      while (at < jobs[j].end && entry != assumed) {
+        editor_row *row = &E.row[at];
+        if (row->evicted) {
+          editor_row_render(row);
+          row->evicted = 0;
+        }
+        assumed = row->hl_open_comment;
+        entry = editor_row_highlight(
+          E.syntax,
+          row,
+          entry,
+          &hl,
+          &hl_capacity,
+          NULL);
+        row->hl_open_comment = entry;
+        at++;
+      }
+    }
+    free(hl);
+  }
+  editor_cache_recount();
+  editor_panes_touch_all();
+  for (j = 0; j < num_jobs; j++) {
+    int k;
+    for (k = 0; k < jobs[j].num_undo; k++) {
+      editor_wrap_update(&E.row[jobs[j].undo[k].row]);
+    }
+  }
+
+  if (E.cursor_y < E.num_rows && E.cursor_x > E.row[E.cursor_y].size) {
+    E.cursor_x = E.row[E.cursor_y].size;
+  }
+}
+
+// Cuts the row table into one range per thread, each noting the comment
+// state the row above it is in before anything changes.
+struct editor_replace_job *editor_replace_jobs(int *num_jobs) {
+  int n = editor_thread_count();
+  if (n > E.num_rows / KILO_HIGHLIGHT_BATCH) {
+    n = E.num_rows / KILO_HIGHLIGHT_BATCH;
+  }
+  if (n < 1) {
+    n = 1;
+  }
+
+  struct editor_replace_job *jobs =
+    calloc(n, sizeof(struct editor_replace_job));
+  if (jobs == NULL) {
+    die("calloc");
+  }
+  int j;
+  for (j = 0; j < n; j++) {
+    jobs[j].rows = E.row;
+    jobs[j].start = (long)E.num_rows * j / n;
+    jobs[j].end = (long)E.num_rows * (j + 1) / n;
+    jobs[j].in_comment =
+      jobs[j].start > 0 ? E.row[jobs[j].start - 1].hl_open_comment : 0;
+  }
+  *num_jobs = n;
+  return jobs;
+}
+
+// Replaces every occurrence of query with with, and returns how many there
+// were.
+long editor_replace_all(const char *query, const char *with) {
+  TRACE_SCOPE("editor_replace_all");
+  editor_wait_rows(INT_MAX);
+  editor_undo_clear();
+
+  int num_jobs;
+  struct editor_replace_job *jobs = editor_replace_jobs(&num_jobs);
+  int j;
+  for (j = 0; j < num_jobs; j++) {
+    jobs[j].query = query;
+    jobs[j].with = with;
+  }
+  editor_run_replace_jobs(jobs, num_jobs);
+
+  struct editor_undo *undo = calloc(1, sizeof(*undo));
+  if (undo == NULL) {
+    die("calloc");
+  }
+  for (j = 0; j < num_jobs; j++) {
+    undo->num_rows += jobs[j].num_undo;
+    undo->count += jobs[j].count;
+  }
+  undo->rows = malloc(sizeof(struct editor_undo_row) * undo->num_rows);
+  if (undo->num_rows > 0 && undo->rows == NULL) {
+    die("malloc");
+  }
+  int at = 0;
+  for (j = 0; j < num_jobs; j++) {
+    if (jobs[j].num_undo > 0) {
+      memcpy(
+        &undo->rows[at],
+        jobs[j].undo,
+        sizeof(struct editor_undo_row) * jobs[j].num_undo);
+    }
+    at += jobs[j].num_undo;
+    free(jobs[j].undo);
+  }
+  free(jobs);
+
+  long count = undo->count;
+  if (undo->num_rows > 0) {
+    E.undo = undo;
+    E.dirty++;
+  } else {
+    free(undo->rows);
+    free(undo);
+  }
+  return count;
+}
+
+void editor_undo_clear(void) {
+  struct editor_undo *undo = E.undo;
+  if (undo == NULL) {
+    return;
+  }
+  int j;
+  for (j = 0; j < undo->num_rows; j++) {
+    free(undo->rows[j].chars);
+  }
+  free(undo->rows);
+  free(undo);
+  E.undo = NULL;
+}
+
+void editor_undo(void) {
+  if (editor_read_only()) {
+    return;
+  }
+  struct editor_undo *undo = E.undo;
+  if (undo == NULL) {
+    editor_set_status_message("Nothing to undo");
+    return;
+  }
+  TRACE_SCOPE("editor_undo");
+
+  int num_jobs;
+  struct editor_replace_job *jobs = editor_replace_jobs(&num_jobs);
+  int at = 0;
+  int j;
+  for (j = 0; j < num_jobs; j++) {
+    jobs[j].undo = &undo->rows[at];
+    while (at < undo->num_rows && undo->rows[at].row < jobs[j].end) {
+      jobs[j].num_undo++;
+      at++;
+    }
+  }
+  editor_run_replace_jobs(jobs, num_jobs);
+  free(jobs);
+
+  editor_set_status_message("Undid replacing %ld occurrences", undo->count);
+  editor_undo_clear();
+  E.dirty++;
+}
+
+void editor_replace(void) {
+  if (editor_read_only()) {
+    return;
+  }
+  char *query = editor_prompt("Replace: %s (ESC to cancel)", NULL);
+  if (query == NULL) {
+    editor_set_status_message("Replace aborted");
+    return;
+  }
+  char *with = editor_prompt("Replace with: %s (ESC to cancel)", NULL);
+  if (with == NULL) {
+    free(query);
+    editor_set_status_message("Replace aborted");
+    return;
+  }
+
+  long count = editor_replace_all(query, with);
+  if (count > 0) {
+    editor_set_status_message(
+      "Replaced %ld occurrences (Ctrl-Z to undo)",
+      count);
+  } else {
+    editor_set_status_message("No occurrences of %s", query);
+  }
+  free(query);
+  free(with);
+}
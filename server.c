@@ -0,0 +1,430 @@
+#include "kilo.h"
+
+/*** data ***/
+
+struct editor_server editor_server = {NULL, -1, -1, 24, 80, NULL, 0, 0, -1};
+
+/*** socket ***/
+
+// $XDG_RUNTIME_DIR/kilo.sock, or kilo.sock in a directory of the user's
+// own under /tmp without one, which editor_socket_check makes.
+char *editor_socket_path(void) {
+  static char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  char *dir = getenv("XDG_RUNTIME_DIR");
+  if (dir && *dir) {
+    snprintf(path, sizeof(path), "%s/%s", dir, KILO_SOCKET_NAME);
+  } else {
+    snprintf(
+      path,
+      sizeof(path),
+      "/tmp/kilo-%d/%s",
+      (int)getuid(),
+      KILO_SOCKET_NAME);
+  }
+  return path;
+}
+
+// Makes sure nobody else can put a socket at path: the directory it is in
+// has to belong to the user and be writable by nobody else. The one under
+// /tmp is made on first use, and refused if someone else made it first.
+int editor_socket_check(const char *path) {
+  char dir[PATH_MAX];
+  snprintf(dir, sizeof(dir), "%s", path);
+  char *slash = strrchr(dir, '/');
+  if (slash == NULL) {
+    snprintf(dir, sizeof(dir), ".");
+  } else if (slash == dir) {
+    dir[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
+
+  char own[PATH_MAX];
+  snprintf(own, sizeof(own), "/tmp/kilo-%d", (int)getuid());
+  if (!strcmp(dir, own) && mkdir(dir, 0700) == -1 && errno != EEXIST) {
+    return -1;
+  }
+
+  struct stat st;
+  if (lstat(dir, &st) == -1) {
+    return -1;
+  }
+  if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() ||
+      (st.st_mode & (S_IWGRP | S_IWOTH))) {
+    errno = EACCES;
+    return -1;
+  }
+  return 0;
+}
+
+// Returns whether the process at the other end of fd runs as the user.
+int editor_socket_trusted(int fd) {
+  struct ucred cred;
+  socklen_t length = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) == -1) {
+    return 0;
+  }
+  return cred.uid == getuid();
+}
+
+int editor_socket_address(const char *path, struct sockaddr_un *address) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address->sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  strcpy(address->sun_path, path);
+  return 0;
+}
+
+int editor_write_all(int fd, const char *buffer, int length) {
+  while (length > 0) {
+    ssize_t written = send(fd, buffer, length, MSG_NOSIGNAL);
+    if (written == -1 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return -1;
+    }
+    buffer += written;
+    length -= written;
+  }
+  return 0;
+}
+
+/*** server terminal ***/
+
+void editor_server_detach(void) {
+  struct editor_server *server = &editor_server;
+  if (server->client_fd == -1) {
+    return;
+  }
+  editor_write("\x1b[2J", 4);
+  editor_write("\x1b[H", 3);
+  close(server->client_fd);
+  server->client_fd = -1;
+}
+
+// Keys come from the attached client. Once it is gone every read returns
+// ESC, which backs out of any prompt that is still open.
+int editor_server_read_key(void) {
+  struct editor_server *server = &editor_server;
+  int nread;
+  char c;
+  while (server->client_fd != -1 &&
+         (nread = read(server->client_fd, &c, 1)) != 1) {
+    if (nread == 0 ||
+        (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      close(server->client_fd);
+      server->client_fd = -1;
+      break;
+    }
+    editor_idle();
+  }
+  if (server->client_fd == -1) {
+    return '\x1b';
+  }
+
+  if (c == '\x1b') {
+    return terminal_read_escape(server->client_fd);
+  }
+  return c;
+}
+
+void editor_server_write(const char *buffer, int length) {
+  struct editor_server *server = &editor_server;
+  if (server->client_fd == -1) {
+    return;
+  }
+  if (editor_write_all(server->client_fd, buffer, length) == -1) {
+    close(server->client_fd);
+    server->client_fd = -1;
+  }
+}
+
+int editor_server_get_window_size(int *rows, int *cols) {
+  *rows = editor_server.rows;
+  *cols = editor_server.cols;
+  return 0;
+}
+
+struct editor_terminal terminal_socket = {
+  editor_server_read_key,
+  editor_server_write,
+  editor_server_get_window_size,
+  editor_server_detach
+};
+
+/*** server ***/
+
+int editor_server_listen(char *path) {
+  struct sockaddr_un address;
+  if (editor_socket_check(path) == -1 ||
+      editor_socket_address(path, &address) == -1) {
+    return -1;
+  }
+
+  // A socket left behind by a server that is gone is replaced, one that
+  // still answers is not.
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+    close(fd);
+    errno = EADDRINUSE;
+    return -1;
+  }
+  close(fd);
+  unlink(path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  mode_t mask = umask(077);
+  int bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+  umask(mask);
+  if (bound == -1 || listen(fd, 8) == -1) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Makes the buffer for path the one E holds, loading it on first use, and
+// returns its index or -1 when the file cannot be read. The terminal,
+// window size, stats and macro belong to the session, not the buffer, and
+// stay as they are.
+int editor_server_switch(char *path) {
+  struct editor_server *server = &editor_server;
+  int j;
+  for (j = 0; j < server->num_buffers; j++) {
+    if (!strcmp(server->buffers[j].path, path)) {
+      break;
+    }
+  }
+  if (j == server->num_buffers && access(path, R_OK) == -1) {
+    return -1;
+  }
+
+  if (j != server->current) {
+    if (server->current != -1) {
+      server->buffers[server->current].config = E;
+    }
+    struct editor_config session = E;
+    if (j == server->num_buffers) {
+      if (server->num_buffers == server->capacity) {
+        server->capacity = editor_grow_capacity(
+          server->capacity,
+          server->num_buffers + 1);
+        server->buffers = realloc(
+          server->buffers,
+          sizeof(struct editor_server_buffer) * server->capacity);
+        if (server->buffers == NULL) {
+          die("realloc");
+        }
+      }
+      editor_init_buffer();
+      if (editor_view_needed(path)) {
+        editor_view_open(path, KILO_VIEW_MEMORY);
+      } else {
+        editor_open(path);
+      }
+      server->buffers[j].path = strdup(path);
+      server->num_buffers++;
+    } else {
+      E = server->buffers[j].config;
+      E.terminal = session.terminal;
+      E.stats = session.stats;
+      E.macro = session.macro;
+    }
+  }
+
+  E.screen_rows = server->rows - 2;
+  E.screen_cols = server->cols;
+  if (E.panes) {
+    editor_panes_resize(server->rows, server->cols);
+  }
+  server->current = j;
+  return j;
+}
+
+// Reads the line a client opens with: its window size and the absolute
+// path of the file it wants.
+char *editor_server_handshake(int fd, int *rows, int *cols) {
+  char line[PATH_MAX + 32];
+  unsigned int length = 0;
+  int waits = 0;
+  while (length < sizeof(line) - 1) {
+    ssize_t nread = read(fd, &line[length], 1);
+    if (nread == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+        ++waits < 20) {
+      continue;
+    }
+    if (nread != 1) {
+      return NULL;
+    }
+    if (line[length] == '\n') {
+      break;
+    }
+    length++;
+  }
+  line[length] = '\0';
+
+  int offset;
+  if (sscanf(line, "%d %d %n", rows, cols, &offset) != 2 ||
+      *rows < 3 || *cols < 1 || line[offset] != '/') {
+    return NULL;
+  }
+  return strdup(&line[offset]);
+}
+
+// Serves one client until it detaches or goes away.
+void editor_server_attach(int fd) {
+  struct editor_server *server = &editor_server;
+  struct timeval timeout = {0, 100000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  int rows;
+  int cols;
+  char *path = editor_server_handshake(fd, &rows, &cols);
+  if (path == NULL) {
+    close(fd);
+    return;
+  }
+  server->rows = rows;
+  server->cols = cols;
+  server->client_fd = fd;
+
+  if (editor_server_switch(path) == -1) {
+    char message[PATH_MAX + 32];
+    int length = snprintf(
+      message,
+      sizeof(message),
+      "kilo: can't open %s\r\n",
+      path);
+    editor_server_write(message, length);
+    if (server->client_fd != -1) {
+      close(server->client_fd);
+      server->client_fd = -1;
+    }
+    free(path);
+    return;
+  }
+  free(path);
+
+  editor_set_status_message(
+    "HELP: Ctrl-S = save | Ctrl-Q = detach | Ctrl-F = find | Ctrl-R = replace"
+  );
+  while (server->client_fd != -1) {
+    editor_refresh_screen();
+    editor_process_keypress();
+  }
+}
+
+// Loads files and then serves clients one at a time, forever. While none is
+// attached, the current buffer keeps taking in rows from its loader.
+void editor_server_run(char *socket_path, char **files, int num_files) {
+  struct editor_server *server = &editor_server;
+  server->socket_path = socket_path;
+  server->listen_fd = editor_server_listen(socket_path);
+  if (server->listen_fd == -1) {
+    die(socket_path);
+  }
+
+  int j;
+  for (j = 0; j < num_files; j++) {
+    char *path = realpath(files[j], NULL);
+    if (path == NULL || editor_server_switch(path) == -1) {
+      die(files[j]);
+    }
+    free(path);
+  }
+
+  while (1) {
+    struct pollfd listener = {server->listen_fd, POLLIN, 0};
+    if (poll(&listener, 1, 100) <= 0) {
+      if (server->current != -1) {
+        editor_idle();
+      }
+      continue;
+    }
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd == -1) {
+      continue;
+    }
+    // Only the user's own clients are served.
+    if (editor_socket_trusted(fd)) {
+      editor_server_attach(fd);
+    } else {
+      close(fd);
+    }
+  }
+}
+
+/*** client ***/
+
+// Attaches the terminal to the server's buffer for filename: keys go to the
+// server as typed and screen updates come back to be written as they are.
+int editor_client_run(char *socket_path, char *filename) {
+  char *path = realpath(filename, NULL);
+  if (path == NULL) {
+    die(filename);
+  }
+
+  struct sockaddr_un address;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1 || editor_socket_check(socket_path) == -1 ||
+      editor_socket_address(socket_path, &address) == -1 ||
+      connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+    die(socket_path);
+  }
+  // Keys are only ever sent to a server run by the same user.
+  if (!editor_socket_trusted(fd)) {
+    errno = EACCES;
+    die(socket_path);
+  }
+
+  enable_raw_mode();
+  int rows;
+  int cols;
+  if (get_window_size(&rows, &cols) == -1) {
+    die("get_window_size");
+  }
+  char line[PATH_MAX + 32];
+  int length = snprintf(line, sizeof(line), "%d %d %s\n", rows, cols, path);
+  free(path);
+  if (editor_write_all(fd, line, length) == -1) {
+    die("send");
+  }
+
+  char buffer[65536];
+  while (1) {
+    struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0}};
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      die("poll");
+    }
+    if (fds[0].revents & POLLIN) {
+      ssize_t nread = read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (nread > 0 && editor_write_all(fd, buffer, nread) == -1) {
+        break;
+      }
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+      ssize_t nread = read(fd, buffer, sizeof(buffer));
+      if (nread <= 0) {
+        break;
+      }
+      if (write(STDOUT_FILENO, buffer, nread) != nread) {
+        break;
+      }
+    }
+  }
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include "kilo.h"
+
+/*** allocation counting ***/
+
+// glibc lets the program replace malloc and friends while still reaching
+// the real allocator, which is the cheapest way to count every allocation
+// made on behalf of a frame, including those inside libc. Only malloc,
+// calloc and realloc are counted: the editor makes no aligned allocations,
+// and posix_memalign, aligned_alloc and memalign are left to glibc.
+// Counting is off until stats are, which is before any thread starts, so
+// with stats off every hook costs one test of editor_counting and worker
+// threads never share the counter's cache line.
+int editor_counting;
+long editor_allocations;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) {
+  if (editor_counting) {
+    __atomic_fetch_add(&editor_allocations, 1, __ATOMIC_RELAXED);
+  }
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (editor_counting) {
+    __atomic_fetch_add(&editor_allocations, 1, __ATOMIC_RELAXED);
+  }
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+  if (editor_counting) {
+    __atomic_fetch_add(&editor_allocations, 1, __ATOMIC_RELAXED);
+  }
+  return __libc_realloc(p, size);
+}
+#endif
+
+/*** stats ***/
+
+double editor_stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void editor_stats_dump(void) {
+  struct editor_stats *stats = &E.stats;
+  FILE *fp = fopen(stats->dump_path, "w");
+  if (fp == NULL) {
+    return;
+  }
+
+  fprintf(
+    fp,
+    "# frame time_s input_to_paint_us process_us draw_us write_us "
+    "bytes allocations\n");
+  int j;
+  for (j = 0; j < stats->num_frames; j++) {
+    struct editor_frame_stats *frame = &stats->frames[j];
+    fprintf(fp, "%d %.6f ", j, frame->time - stats->start);
+    if (frame->input_to_paint < 0) {
+      fprintf(fp, "- - ");
+    } else {
+      fprintf(
+        fp,
+        "%.1f %.1f ",
+        frame->input_to_paint * 1e6,
+        frame->process * 1e6);
+    }
+    fprintf(
+      fp,
+      "%.1f %.1f %ld %ld\n",
+      frame->draw * 1e6,
+      frame->write * 1e6,
+      frame->bytes,
+      frame->allocations);
+  }
+  fclose(fp);
+}
+
+void editor_stats_enable(char *dump_path) {
+  struct editor_stats *stats = &E.stats;
+  stats->enabled = 1;
+  stats->dump_path = dump_path;
+  stats->start = editor_stats_now();
+  editor_counting = 1;
+  stats->last_allocations = editor_allocations;
+  atexit(editor_stats_dump);
+}
+
+void editor_stats_key(void) {
+  if (!E.stats.enabled) {
+    return;
+  }
+  E.stats.key_time = editor_stats_now();
+  E.stats.key_pending = 1;
+}
+
+void editor_stats_processed(void) {
+  if (!E.stats.enabled) {
+    return;
+  }
+  E.stats.process = editor_stats_now() - E.stats.key_time;
+}
+
+void editor_stats_frame_start(void) {
+  if (!E.stats.enabled) {
+    return;
+  }
+  E.stats.frame_start = editor_stats_now();
+}
+
+void editor_stats_drawn(void) {
+  if (!E.stats.enabled) {
+    return;
+  }
+  E.stats.draw_end = editor_stats_now();
+}
+
+void editor_stats_written(long bytes) {
+  struct editor_stats *stats = &E.stats;
+  if (!stats->enabled) {
+    return;
+  }
+
+  if (stats->num_frames == stats->frame_capacity) {
+    stats->frame_capacity = stats->frame_capacity ?
+      stats->frame_capacity * 2 : 1024;
+    stats->frames = realloc(
+      stats->frames,
+      sizeof(struct editor_frame_stats) * stats->frame_capacity);
+    if (stats->frames == NULL) {
+      die("realloc");
+    }
+  }
+
+  double now = editor_stats_now();
+  struct editor_frame_stats *frame = &stats->frames[stats->num_frames++];
+  frame->time = now;
+  frame->input_to_paint = -1;
+  frame->process = 0;
+  if (stats->key_pending) {
+    frame->input_to_paint = now - stats->key_time;
+    frame->process = stats->process;
+    stats->latency[stats->next_latency] = frame->input_to_paint;
+    stats->next_latency = (stats->next_latency + 1) % KILO_STATS_WINDOW;
+    if (stats->num_latency < KILO_STATS_WINDOW) {
+      stats->num_latency++;
+    }
+    stats->key_pending = 0;
+  }
+  frame->draw = stats->draw_end - stats->frame_start;
+  frame->write = now - stats->draw_end;
+  frame->bytes = bytes;
+  frame->allocations = editor_allocations - stats->last_allocations;
+  stats->last_allocations = editor_allocations;
+}
+
+int editor_stats_compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Summarizes the rolling window for the status bar: input-to-paint p50 and
+// p99, then bytes written and allocations made by the previous frame.
+int editor_stats_format(char *buffer, int size) {
+  struct editor_stats *stats = &E.stats;
+  if (!stats->enabled) {
+    return 0;
+  }
+
+  double sorted[KILO_STATS_WINDOW];
+  memcpy(sorted, stats->latency, sizeof(double) * stats->num_latency);
+  qsort(sorted, stats->num_latency, sizeof(double), editor_stats_compare);
+
+  double p50 = 0;
+  double p99 = 0;
+  if (stats->num_latency) {
+    p50 = sorted[stats->num_latency / 2];
+    p99 = sorted[stats->num_latency * 99 / 100];
+  }
+
+  struct editor_frame_stats *last = NULL;
+  if (stats->num_frames) {
+    last = &stats->frames[stats->num_frames - 1];
+  }
+  return snprintf(
+    buffer,
+    size,
+    "p50 %.2fms p99 %.2fms %ldB %ld alloc | ",
+    p50 * 1e3,
+    p99 * 1e3,
+    last ? last->bytes : 0,
+    last ? last->allocations : 0);
+}
@@ -0,0 +1,633 @@
+#include "kilo.h"
+
+/*** file types ***/
+
+char *C_HL_extensions[] = { ".c", ".h", ".cpp", NULL };
+char *C_HL_keywords[] = {
+  "switch", "if", "while", "for", "break", "continue", "return", "else",
+  "struct", "union", "typedef", "static", "enum", "class", "case",
+
+  "int|", "long|", "double|", "float|", "char|", "unsigned|", "signed|",
+  "void|", NULL
+};
+
+struct editor_syntax HLDB[] = {
+  {
+    "c",
+    C_HL_extensions,
+    C_HL_keywords,
+    "//",
+    "/*",
+    "*/",
+    HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS,
+    NULL,
+    NULL,
+    NULL
+  },
+};
+
+#define HLDB_ENTRIES (sizeof(HLDB) / sizeof(HLDB[0]))
+
+/*** syntax highlighting ***/
+
+int is_separator(int c) {
+  return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+}
+
+unsigned char *editor_highlight_scratch(int size) {
+  static unsigned char *scratch = NULL;
+  static int scratch_capacity = 0;
+
+  if (size > scratch_capacity) {
+    scratch_capacity =
+      size > 2 * scratch_capacity ? size : 2 * scratch_capacity;
+    free(scratch);
+    scratch = malloc(scratch_capacity);
+    if (scratch == NULL) {
+      die("malloc");
+    }
+  }
+  return scratch;
+}
+
+// Replaces the row's spans with the run-length encoding of hl, which holds
+// one highlight class per render column from render_start on. New span
+// storage comes from arena when one is given, and from the heap otherwise.
+void editor_row_store_highlight(
+  editor_row *row,
+  unsigned char *hl,
+  struct editor_arena_chunk **arena) {
+  int length = row->render_size - row->render_start;
+  int runs = 0;
+  int all_normal = 1;
+  int i;
+  for (i = 0; i < length; i++) {
+    if (i == 0 || hl[i] != hl[i - 1]) {
+      runs++;
+    }
+    if (hl[i] != HL_NORMAL) {
+      all_normal = 0;
+    }
+  }
+  if (all_normal) {
+    runs = 0;
+  }
+
+  if (runs > row->hl_capacity) {
+    if (!row->hl_in_arena) {
+      free(row->hl);
+    }
+    if (arena) {
+      row->hl_capacity = runs;
+      row->hl = (struct editor_hl_span *)editor_arena_alloc(
+        arena,
+        sizeof(struct editor_hl_span) * runs);
+      row->hl_in_arena = 1;
+    } else {
+      row->hl_capacity = runs > 2 * row->hl_capacity ?
+        runs : 2 * row->hl_capacity;
+      row->hl = malloc(sizeof(struct editor_hl_span) * row->hl_capacity);
+      if (row->hl == NULL) {
+        die("malloc");
+      }
+      row->hl_in_arena = 0;
+    }
+  }
+
+  row->num_hl = runs;
+  if (runs == 0) {
+    return;
+  }
+
+  runs = 0;
+  for (i = 0; i < length; i++) {
+    if (i == 0 || hl[i] != hl[i - 1]) {
+      row->hl[runs].start = row->render_start + i;
+      row->hl[runs].highlight = hl[i];
+      runs++;
+    }
+  }
+}
+
+// While a file is loading, spans are sized exactly and kept in an arena of
+// their own, which the cache can compact once it has evicted some of them.
+void editor_row_set_highlight(editor_row *row, unsigned char *hl) {
+  editor_row_store_highlight(row, hl, E.loading ? &E.hl_arena : NULL);
+}
+
+// Expands the row's spans into one highlight class per render column.
+// Spans are cut off at render_size, in case the row changed since they
+// were made and has not been highlighted again yet.
+void editor_row_get_highlight(editor_row *row, unsigned char *hl) {
+  if (row->num_hl == 0) {
+    memset(hl, HL_NORMAL, row->render_size);
+    return;
+  }
+
+  int i;
+  for (i = 0; i < row->num_hl && row->hl[i].start < row->render_size; i++) {
+    int end = (i + 1 < row->num_hl) ? row->hl[i + 1].start : row->render_size;
+    if (end > row->render_size) {
+      end = row->render_size;
+    }
+    memset(&hl[row->hl[i].start], row->hl[i].highlight, end - row->hl[i].start);
+  }
+}
+
+// Returns the index of the span covering render column at.
+int editor_row_find_span(editor_row *row, int at) {
+  int lo = 0;
+  int hi = row->num_hl;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (row->hl[mid].start <= at) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? lo - 1 : 0;
+}
+
+// Classifies text[i] onwards into hl until reaching stop, resuming from
+// state and leaving in it where scanning stopped. Returns the index it
+// stopped at, which lies past stop when a token straddles it. Tokens are
+// matched against at most size bytes of text, which must be followed by a
+// NUL. Bytes that stay HL_NORMAL are left alone. Only reads its arguments,
+// so text can be scanned from several threads at once.
+int editor_highlight_scan(
+  struct editor_syntax *syntax,
+  const char *text,
+  int size,
+  int i,
+  int stop,
+  struct editor_highlight_state *state,
+  unsigned char *hl) {
+  if (state->line_comment) {
+    if (i < stop) {
+      memset(&hl[i], HL_COMMENT, stop - i);
+      i = stop;
+    }
+    return i;
+  }
+
+  struct editor_lexer *lexer = syntax->lexer;
+  const unsigned char *classes = lexer->classes;
+
+  int in_comment = state->in_comment;
+  int in_string = state->in_string;
+  int prev_sep = state->prev_sep;
+  int prev_number = state->prev_number;
+
+  while (i < stop) {
+    if (in_comment && lexer->block_end_len) {
+      // Skip to the next byte that could start the end of the comment.
+      int end = i;
+      while (end < stop) {
+        const char *p = memchr(&text[end], lexer->block_end[0], stop - end);
+        if (p == NULL) {
+          end = stop;
+          break;
+        }
+        end = p - text;
+        if (end + lexer->block_end_len <= size &&
+            !memcmp(p, lexer->block_end, lexer->block_end_len)) {
+          break;
+        }
+        end++;
+      }
+      prev_number = 0;
+      if (end == stop) {
+        memset(&hl[i], HL_MLCOMMENT, stop - i);
+        i = stop;
+        break;
+      }
+      end += lexer->block_end_len;
+      memset(&hl[i], HL_MLCOMMENT, end - i);
+      i = end;
+      in_comment = 0;
+      prev_sep = 1;
+      continue;
+    }
+
+    if (in_string) {
+      prev_number = 0;
+      while (i < stop) {
+        char c = text[i];
+        hl[i] = HL_STRING;
+        if (c == '\\' && i + 1 < size) {
+          hl[i + 1] = HL_STRING;
+          i += 2;
+          continue;
+        }
+        i++;
+        prev_sep = 1;
+        if (c == in_string) {
+          in_string = 0;
+          break;
+        }
+      }
+      continue;
+    }
+
+    // Bytes of no class are neither separators nor the start of anything.
+    int class = classes[(unsigned char)text[i]];
+    if (class == 0) {
+      do {
+        i++;
+      } while (i < stop && classes[(unsigned char)text[i]] == 0);
+      prev_sep = 0;
+      prev_number = 0;
+      continue;
+    }
+
+    int token = -1;
+    int token_end = i;
+    if ((class & LEX_COMMENT) || ((class & LEX_KEYWORD) && prev_sep)) {
+      token = editor_lexer_match(
+        lexer,
+        text,
+        i,
+        prev_sep,
+        !in_comment,
+        &token_end);
+    }
+    int kind = token >= 0 ? lexer->kinds[token] : -1;
+
+    if (kind == TOKEN_LINE_COMMENT) {
+      memset(&hl[i], HL_COMMENT, stop - i);
+      i = stop;
+      state->line_comment = 1;
+      break;
+    }
+    if (kind == TOKEN_BLOCK_COMMENT) {
+      memset(&hl[i], HL_MLCOMMENT, token_end - i);
+      i = token_end;
+      in_comment = 1;
+      prev_number = 0;
+      continue;
+    }
+
+    if (class & LEX_QUOTE) {
+      in_string = text[i];
+      hl[i] = HL_STRING;
+      prev_number = 0;
+      i++;
+      continue;
+    }
+
+    if (((class & LEX_DIGIT) && (prev_sep || prev_number)) ||
+        ((class & LEX_NUMBER) && prev_number)) {
+      hl[i] = HL_NUMBER;
+      i++;
+      prev_sep = 0;
+      prev_number = 1;
+      continue;
+    }
+    prev_number = 0;
+
+    if (token >= 0) {
+      memset(
+        &hl[i],
+        kind == TOKEN_KEYWORD2 ? HL_KEYWORD2 : HL_KEYWORD1,
+        token_end - i);
+      i = token_end;
+      prev_sep = 0;
+      continue;
+    }
+
+    prev_sep = (class & LEX_SEPARATOR) != 0;
+    i++;
+  }
+
+  state->in_comment = in_comment;
+  state->in_string = in_string;
+  state->prev_sep = prev_sep;
+  state->prev_number = prev_number;
+  return i;
+}
+
+// Classifies every render column of row into hl under syntax, starting
+// inside a multi-line comment if in_comment is set, and returns whether the
+// row ends inside one.
+int editor_highlight_row(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment,
+  unsigned char *hl) {
+  memset(hl, HL_NORMAL, row->render_size);
+
+  if (syntax == NULL) {
+    return in_comment;
+  }
+
+  struct editor_highlight_state state = {in_comment, 0, 1, 0, 0};
+  editor_highlight_scan(
+    syntax,
+    row->render,
+    row->render_size,
+    0,
+    row->render_size,
+    &state,
+    hl);
+  return state.in_comment;
+}
+
+void editor_update_syntax(editor_row *row) {
+  TRACE_SCOPE("editor_update_syntax");
+  // An edit can change the comment state below it all the way into rows
+  // the cache has evicted, which need their render back first.
+  if (row->evicted) {
+    editor_update_row(row);
+    return;
+  }
+  editor_panes_touch(row->idx);
+  if (E.macro.replaying) {
+    editor_macro_defer_highlight(row->idx);
+    return;
+  }
+  if (E.syntax == NULL) {
+    row->num_hl = 0;
+    return;
+  }
+
+  int in_comment = row->idx > 0 && E.row[row->idx - 1].hl_open_comment;
+  if (row->chunks) {
+    in_comment = editor_chunks_highlight(E.syntax, row, in_comment);
+  } else {
+    unsigned char *hl = editor_highlight_scratch(row->render_size);
+    in_comment = editor_highlight_row(E.syntax, row, in_comment, hl);
+    size_t bytes = editor_row_cache_bytes(row);
+    editor_row_set_highlight(row, hl);
+    E.cache_bytes += editor_row_cache_bytes(row) - bytes;
+  }
+
+  int changed = (row->hl_open_comment != in_comment);
+  row->hl_open_comment = in_comment;
+  if (changed && row->idx + 1 < E.num_rows) {
+    editor_update_syntax(&E.row[row->idx + 1]);
+  }
+}
+
+int editor_syntax_to_color(int highlight) {
+  switch (highlight) {
+    case HL_COMMENT:
+    case HL_MLCOMMENT:
+      return 36;
+    case HL_KEYWORD1:
+      return 33;
+    case HL_KEYWORD2:
+      return 32;
+    case HL_STRING:
+      return 35;
+    case HL_NUMBER:
+      return 31;
+    case HL_MATCH:
+      return 34;
+    default:
+      return 37;
+  }
+}
+
+struct editor_sgr editor_sgr[HL_MATCH + 1];
+
+void editor_init_sgr(void) {
+  int highlight;
+  for (highlight = 0; highlight <= HL_MATCH; highlight++) {
+    struct editor_sgr *sgr = &editor_sgr[highlight];
+    if (highlight == HL_NORMAL) {
+      sgr->color = -1;
+      sgr->length = snprintf(sgr->seq, sizeof(sgr->seq), "\x1b[39m");
+    } else {
+      sgr->color = editor_syntax_to_color(highlight);
+      sgr->length = snprintf(
+        sgr->seq,
+        sizeof(sgr->seq),
+        "\x1b[%dm",
+        sgr->color);
+    }
+  }
+}
+
+void editor_select_syntax_highlight(void) {
+  // Rows still being indexed are highlighted with the current syntax.
+  editor_wait_rows(INT_MAX);
+  E.syntax = NULL;
+  if (E.filename == NULL) {
+    return;
+  }
+
+  char *ext = strrchr(E.filename, '.');
+
+  // Definitions read at startup come before the built-in ones.
+  int num_syntax = editor_num_loaded_syntax + (int)HLDB_ENTRIES;
+  for (int j = 0; j < num_syntax; j++) {
+    struct editor_syntax *s = j < editor_num_loaded_syntax ?
+      editor_loaded_syntax[j] :
+      &HLDB[j - editor_num_loaded_syntax];
+    unsigned int i = 0;
+    while (s->file_match[i]) {
+      int is_ext = (s->file_match[i][0] == '.');
+      if ((is_ext && ext && !strcmp(ext, s->file_match[i])) ||
+          (!is_ext && strstr(E.filename, s->file_match[i]))) {
+        if (s->lexer == NULL) {
+          s->lexer = editor_syntax_compile(s);
+        }
+        E.syntax = s;
+        editor_highlight_rows();
+        return;
+      }
+      i++;
+    }
+  }
+}
+
+/*** parallel highlighting ***/
+
+// Rows only depend on each other through hl_open_comment, so the file is cut
+// into one chunk per thread and every chunk is highlighted speculatively as
+// if it started outside a comment. Stitching then walks the chunk
+// boundaries in order: where a chunk actually starts inside a comment, its
+// rows are rehighlighted only until the entry state of a row matches the one
+// it was speculatively highlighted with, after which the rest of the chunk
+// is already right.
+
+struct editor_highlight_job {
+  struct editor_syntax *syntax;
+  editor_row *rows;
+  int start;
+  int end;
+  int in_comment;
+  struct editor_arena_chunk **arena;
+  struct editor_arena_chunk *job_arena;
+  pthread_t thread;
+};
+
+// Grows a highlight buffer owned by the calling thread, since the scratch
+// buffer of editor_highlight_scratch belongs to the main thread.
+unsigned char *editor_highlight_reserve(
+  unsigned char *hl,
+  int *capacity,
+  int size) {
+  if (hl == NULL || size > *capacity) {
+    *capacity = editor_grow_capacity(*capacity, size > 0 ? size : 1);
+    free(hl);
+    hl = malloc(*capacity);
+    if (hl == NULL) {
+      die("malloc");
+    }
+  }
+  return hl;
+}
+
+// Highlights row, starting inside a multi-line comment if in_comment is set,
+// into spans taken from arena, or the heap without one, and returns whether
+// it ends inside one. *hl is a buffer of the calling thread, grown as
+// needed. A long row only has its checkpoints brought up to date, since its
+// spans are made when it is drawn.
+int editor_row_highlight(
+  struct editor_syntax *syntax,
+  editor_row *row,
+  int in_comment,
+  unsigned char **hl,
+  int *hl_capacity,
+  struct editor_arena_chunk **arena) {
+  if (row->chunks) {
+    return editor_chunks_highlight(syntax, row, in_comment);
+  }
+  *hl = editor_highlight_reserve(*hl, hl_capacity, row->render_size);
+  in_comment = editor_highlight_row(syntax, row, in_comment, *hl);
+  editor_row_store_highlight(row, *hl, arena);
+  return in_comment;
+}
+
+void *editor_highlight_worker(void *arg) {
+  TRACE_SCOPE("editor_highlight_worker");
+  struct editor_highlight_job *job = arg;
+  unsigned char *hl = NULL;
+  int hl_capacity = 0;
+  int in_comment = job->in_comment;
+
+  int j;
+  for (j = job->start; j < job->end; j++) {
+    editor_row *row = &job->rows[j];
+    in_comment = editor_row_highlight(
+      job->syntax,
+      row,
+      in_comment,
+      &hl,
+      &hl_capacity,
+      job->arena ? &job->job_arena : NULL);
+    row->hl_open_comment = in_comment;
+  }
+
+  free(hl);
+  return NULL;
+}
+
+// Highlights num_rows rows under syntax, the first of which starts inside a
+// multi-line comment if in_comment is set. Spans come from arena when one is
+// given and from the heap otherwise. Nothing here touches E, so the
+// background indexer can highlight rows before they join the row table.
+void editor_highlight_range(
+  struct editor_syntax *syntax,
+  editor_row *rows,
+  int num_rows,
+  int in_comment,
+  struct editor_arena_chunk **arena) {
+  TRACE_SCOPE("editor_highlight_range");
+  if (syntax == NULL || num_rows == 0) {
+    return;
+  }
+
+  int num_jobs = editor_thread_count();
+  if (num_jobs > num_rows / KILO_HIGHLIGHT_BATCH) {
+    num_jobs = num_rows / KILO_HIGHLIGHT_BATCH;
+  }
+  if (num_jobs < 1) {
+    num_jobs = 1;
+  }
+
+  struct editor_highlight_job *jobs =
+    malloc(sizeof(struct editor_highlight_job) * num_jobs);
+  if (jobs == NULL) {
+    die("malloc");
+  }
+  int j;
+  for (j = 0; j < num_jobs; j++) {
+    jobs[j].syntax = syntax;
+    jobs[j].rows = rows;
+    jobs[j].start = (long)num_rows * j / num_jobs;
+    jobs[j].end = (long)num_rows * (j + 1) / num_jobs;
+    jobs[j].in_comment = (j == 0) ? in_comment : 0;
+    jobs[j].arena = arena;
+    jobs[j].job_arena = NULL;
+  }
+  for (j = 1; j < num_jobs; j++) {
+    if (pthread_create(
+        &jobs[j].thread,
+        NULL,
+        editor_highlight_worker,
+        &jobs[j]) != 0) {
+      die("pthread_create");
+    }
+  }
+  editor_highlight_worker(&jobs[0]);
+  for (j = 1; j < num_jobs; j++) {
+    pthread_join(jobs[j].thread, NULL);
+  }
+
+  if (arena) {
+    for (j = 0; j < num_jobs; j++) {
+      editor_arena_adopt(arena, jobs[j].job_arena);
+    }
+  }
+
+  unsigned char *hl = NULL;
+  int hl_capacity = 0;
+  for (j = 1; j < num_jobs; j++) {
+    int entry = rows[jobs[j].start - 1].hl_open_comment;
+    int assumed = 0;
+    int at = jobs[j].start;
+    while (at < jobs[j].end && entry != assumed) {
+      editor_row *row = &rows[at];
+      assumed = row->hl_open_comment;
+      entry = editor_row_highlight(
+        syntax,
+        row,
+        entry,
+        &hl,
+        &hl_capacity,
+        arena);
+      row->hl_open_comment = entry;
+      at++;
+    }
+  }
+
+  free(hl);
+  free(jobs);
+}
+
+void editor_highlight_rows(void) {
+  int j;
+  for (j = 0; j < E.num_rows; j++) {
+    if (E.row[j].evicted) {
+      editor_row_render(&E.row[j]);
+      E.row[j].evicted = 0;
+    }
+    // Checkpoints taken under another syntax no longer hold.
+    struct editor_chunks *chunks = E.row[j].chunks;
+    if (chunks) {
+      chunks->highlight_from = 0;
+      chunks->highlight_to = chunks->num_chunks - 1;
+    }
+  }
+  editor_highlight_range(
+    E.syntax,
+    E.row,
+    E.num_rows,
+    0,
+    E.loading ? &E.hl_arena : NULL);
+  editor_cache_recount();
+  editor_panes_touch_all();
+}
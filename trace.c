@@ -0,0 +1,156 @@
+#include "kilo.h"
+
+#include <sys/syscall.h>
+
+/*** data ***/
+
+// Each thread records its spans into its own ring, so recording needs no
+// locks: only the owning thread writes a ring, and the head index is
+// published with a release store for the dump at exit. Rings are pushed onto
+// a global list with a compare-and-swap when a thread records its first
+// span. A full ring overwrites its oldest events. Workers come and go with
+// every batch and command, so a thread that exits gives its ring back, and
+// the next new thread takes it over instead of allocating another. Events
+// keep the id of the thread that recorded them.
+struct editor_trace_event {
+  const char *name;
+  double begin;
+  double duration;
+  long tid;
+};
+
+struct editor_trace_ring {
+  struct editor_trace_ring *next;
+  int in_use;
+  long tid;
+  unsigned long head;
+  struct editor_trace_event events[KILO_TRACE_RING];
+};
+
+struct editor_trace_ring *editor_trace_rings;
+__thread struct editor_trace_ring *editor_trace_ring;
+pthread_key_t editor_trace_key;
+pthread_once_t editor_trace_once = PTHREAD_ONCE_INIT;
+
+/*** trace ***/
+
+double editor_trace_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Runs as a thread exits, to give its ring back.
+void editor_trace_release(void *arg) {
+  struct editor_trace_ring *ring = arg;
+  __atomic_store_n(&ring->in_use, 0, __ATOMIC_RELEASE);
+}
+
+void editor_trace_make_key(void) {
+  if (pthread_key_create(&editor_trace_key, editor_trace_release) != 0) {
+    die("pthread_key_create");
+  }
+}
+
+// Takes a ring given back by a thread that has exited, or NULL.
+struct editor_trace_ring *editor_trace_reuse(void) {
+  struct editor_trace_ring *ring =
+    __atomic_load_n(&editor_trace_rings, __ATOMIC_ACQUIRE);
+  for (; ring; ring = ring->next) {
+    int idle = 0;
+    if (__atomic_compare_exchange_n(
+        &ring->in_use,
+        &idle,
+        1,
+        0,
+        __ATOMIC_ACQ_REL,
+        __ATOMIC_RELAXED)) {
+      return ring;
+    }
+  }
+  return NULL;
+}
+
+struct editor_trace_ring *editor_trace_thread_ring(void) {
+  if (editor_trace_ring == NULL) {
+    pthread_once(&editor_trace_once, editor_trace_make_key);
+    struct editor_trace_ring *ring = editor_trace_reuse();
+    if (ring == NULL) {
+      ring = calloc(1, sizeof(*ring));
+      if (ring == NULL) {
+        die("calloc");
+      }
+      ring->in_use = 1;
+      ring->next = __atomic_load_n(&editor_trace_rings, __ATOMIC_ACQUIRE);
+      while (!__atomic_compare_exchange_n(
+          &editor_trace_rings,
+          &ring->next,
+          ring,
+          0,
+          __ATOMIC_RELEASE,
+          __ATOMIC_ACQUIRE)) {
+      }
+    }
+    ring->tid = syscall(SYS_gettid);
+    pthread_setspecific(editor_trace_key, ring);
+    editor_trace_ring = ring;
+  }
+  return editor_trace_ring;
+}
+
+struct editor_trace_scope editor_trace_begin(const char *name) {
+  struct editor_trace_scope scope;
+  scope.name = name;
+  scope.begin = editor_trace_now();
+  return scope;
+}
+
+void editor_trace_end(struct editor_trace_scope *scope) {
+  struct editor_trace_ring *ring = editor_trace_thread_ring();
+  unsigned long head = ring->head;
+  struct editor_trace_event *event = &ring->events[head % KILO_TRACE_RING];
+  event->name = scope->name;
+  event->begin = scope->begin;
+  event->duration = editor_trace_now() - scope->begin;
+  event->tid = ring->tid;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Writes every recorded span as a Chrome trace_event "complete" event, which
+// chrome://tracing and Perfetto load directly.
+void editor_trace_dump(void) {
+  char *path = getenv("KILO_TRACE_FILE");
+  FILE *fp = fopen(path ? path : "kilo-trace.json", "w");
+  if (fp == NULL) {
+    return;
+  }
+
+  fprintf(fp, "{\"traceEvents\":[\n");
+  int first = 1;
+  struct editor_trace_ring *ring =
+    __atomic_load_n(&editor_trace_rings, __ATOMIC_ACQUIRE);
+  for (; ring; ring = ring->next) {
+    unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    unsigned long j = head > KILO_TRACE_RING ? head - KILO_TRACE_RING : 0;
+    for (; j < head; j++) {
+      struct editor_trace_event *event = &ring->events[j % KILO_TRACE_RING];
+      fprintf(
+        fp,
+        "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+        "\"pid\":%ld,\"tid\":%ld}",
+        first ? "" : ",\n",
+        event->name,
+        event->begin,
+        event->duration,
+        (long)getpid(),
+        event->tid);
+      first = 0;
+    }
+  }
+  fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  fclose(fp);
+}
+
+void editor_trace_init(void) {
+  atexit(editor_trace_dump);
+}
@@ -0,0 +1,335 @@
+#include "kilo.h"
+
+/*** utf-8 ***/
+
+// Rows are bytes, and render is too. Where a row holds anything but ASCII,
+// its screen columns part ways with its render bytes, and editor_row_render
+// records where in glyph runs. Between two runs bytes and columns advance
+// in lockstep, as they do between two tab stops, so converting either way
+// is a binary search over the runs instead of a scan of the row. Marks that
+// take no columns count as part of the character before them, which is as
+// close to grapheme clusters as the editor gets.
+//
+// A row past KILO_CHUNK_ROW only renders the window on screen and has no
+// runs. It draws every byte past ASCII as a column of its own.
+
+struct editor_width_range {
+  unsigned int first;
+  unsigned int last;
+  int width;
+};
+
+// Code points that do not take one column, after Markus Kuhn's wcwidth.
+// Anything missing from here takes one.
+struct editor_width_range editor_width_ranges[] = {
+  {0x0300, 0x036f, 0}, {0x0483, 0x0489, 0}, {0x0591, 0x05bd, 0},
+  {0x05bf, 0x05bf, 0}, {0x05c1, 0x05c2, 0}, {0x05c4, 0x05c5, 0},
+  {0x05c7, 0x05c7, 0}, {0x0610, 0x061a, 0}, {0x064b, 0x065f, 0},
+  {0x0670, 0x0670, 0}, {0x06d6, 0x06dc, 0}, {0x06df, 0x06e4, 0},
+  {0x06e7, 0x06e8, 0}, {0x06ea, 0x06ed, 0}, {0x0e31, 0x0e31, 0},
+  {0x0e34, 0x0e3a, 0}, {0x0e47, 0x0e4e, 0}, {0x1100, 0x115f, 2},
+  {0x1160, 0x11ff, 0}, {0x1ab0, 0x1aff, 0}, {0x1dc0, 0x1dff, 0},
+  {0x200b, 0x200f, 0}, {0x202a, 0x202e, 0}, {0x2060, 0x2064, 0},
+  {0x20d0, 0x20ff, 0}, {0x231a, 0x231b, 2}, {0x2329, 0x232a, 2},
+  {0x23e9, 0x23ec, 2}, {0x23f0, 0x23f0, 2}, {0x23f3, 0x23f3, 2},
+  {0x25fd, 0x25fe, 2}, {0x2614, 0x2615, 2}, {0x2648, 0x2653, 2},
+  {0x267f, 0x267f, 2}, {0x2693, 0x2693, 2}, {0x26a1, 0x26a1, 2},
+  {0x26aa, 0x26ab, 2}, {0x26bd, 0x26be, 2}, {0x26c4, 0x26c5, 2},
+  {0x26ce, 0x26ce, 2}, {0x26d4, 0x26d4, 2}, {0x26ea, 0x26ea, 2},
+  {0x26f2, 0x26f3, 2}, {0x26f5, 0x26f5, 2}, {0x26fa, 0x26fa, 2},
+  {0x26fd, 0x26fd, 2}, {0x2705, 0x2705, 2}, {0x270a, 0x270b, 2},
+  {0x2728, 0x2728, 2}, {0x274c, 0x274c, 2}, {0x274e, 0x274e, 2},
+  {0x2753, 0x2755, 2}, {0x2757, 0x2757, 2}, {0x2795, 0x2797, 2},
+  {0x27b0, 0x27b0, 2}, {0x27bf, 0x27bf, 2}, {0x2b1b, 0x2b1c, 2},
+  {0x2b50, 0x2b50, 2}, {0x2b55, 0x2b55, 2}, {0x2e80, 0x303e, 2},
+  {0x3041, 0x33ff, 2}, {0x3400, 0x4dbf, 2}, {0x4e00, 0x9fff, 2},
+  {0xa000, 0xa4cf, 2}, {0xa960, 0xa97f, 2}, {0xac00, 0xd7a3, 2},
+  {0xf900, 0xfaff, 2}, {0xfe00, 0xfe0f, 0}, {0xfe10, 0xfe19, 2},
+  {0xfe20, 0xfe2f, 0}, {0xfe30, 0xfe6f, 2}, {0xfeff, 0xfeff, 0},
+  {0xff00, 0xff60, 2}, {0xffe0, 0xffe6, 2}, {0x16fe0, 0x16fe4, 2},
+  {0x17000, 0x18cff, 2}, {0x1b000, 0x1b2ff, 2}, {0x1f004, 0x1f004, 2},
+  {0x1f0cf, 0x1f0cf, 2}, {0x1f18e, 0x1f18e, 2}, {0x1f191, 0x1f19a, 2},
+  {0x1f200, 0x1f251, 2}, {0x1f300, 0x1f64f, 2}, {0x1f680, 0x1f6ff, 2},
+  {0x1f7e0, 0x1f7eb, 2}, {0x1f90c, 0x1f9ff, 2}, {0x1fa70, 0x1faff, 2},
+  {0x20000, 0x2fffd, 2}, {0x30000, 0x3fffd, 2}, {0xe0100, 0xe01ef, 0},
+};
+
+#define WIDTH_RANGES \
+  (int)(sizeof(editor_width_ranges) / sizeof(editor_width_ranges[0]))
+
+// Decodes the UTF-8 sequence at the start of the len bytes at s, and
+// returns its length, or 0 if it is not a valid one. Overlong forms,
+// surrogates and code points past U+10FFFF are all invalid.
+int editor_utf8_decode(const char *s, int len, unsigned int *code_point) {
+  const unsigned char *u = (const unsigned char *)s;
+  unsigned int c = u[0];
+  unsigned int min;
+  int size;
+  if (c < 0x80) {
+    *code_point = c;
+    return 1;
+  } else if (c >= 0xc2 && c <= 0xdf) {
+    size = 2;
+    c &= 0x1f;
+    min = 0x80;
+  } else if (c >= 0xe0 && c <= 0xef) {
+    size = 3;
+    c &= 0x0f;
+    min = 0x800;
+  } else if (c >= 0xf0 && c <= 0xf4) {
+    size = 4;
+    c &= 0x07;
+    min = 0x10000;
+  } else {
+    return 0;
+  }
+
+  if (len < size) {
+    return 0;
+  }
+  int j;
+  for (j = 1; j < size; j++) {
+    if ((u[j] & 0xc0) != 0x80) {
+      return 0;
+    }
+    c = (c << 6) | (u[j] & 0x3f);
+  }
+  if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+    return 0;
+  }
+  *code_point = c;
+  return size;
+}
+
+int editor_char_width(unsigned int code_point) {
+  if (code_point < 0x300) {
+    return 1;
+  }
+  int lo = 0;
+  int hi = WIDTH_RANGES;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (editor_width_ranges[mid].last < code_point) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < WIDTH_RANGES && editor_width_ranges[lo].first <= code_point) {
+    return editor_width_ranges[lo].width;
+  }
+  return 1;
+}
+
+// Returns how many of the len bytes at s are ASCII before the first one that
+// is not. With SSE2 the top bits of sixteen bytes come out of one movemask.
+int editor_ascii_prefix(const char *s, int len) {
+  int j = 0;
+#ifdef __SSE2__
+  for (; len - j >= 16; j += 16) {
+    unsigned int mask =
+      _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)&s[j]));
+    if (mask) {
+      return j + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (j < len && (unsigned char)s[j] < 0x80) {
+    j++;
+  }
+  return j;
+}
+
+void editor_row_add_glyph(
+  editor_row *row,
+  int at,
+  int column,
+  int size,
+  int width,
+  int valid) {
+  if (row->num_glyph_runs > 0) {
+    struct editor_glyph_run *last = &row->glyph_runs[row->num_glyph_runs - 1];
+    if (editor_glyph_run_end(last) == at && last->size == size &&
+        last->width == width && last->valid == valid) {
+      last->count++;
+      return;
+    }
+  }
+
+  if (row->num_glyph_runs == row->glyph_capacity) {
+    row->glyph_capacity = editor_grow_capacity(
+      row->glyph_capacity,
+      row->num_glyph_runs + 1);
+    row->glyph_runs = realloc(
+      row->glyph_runs,
+      sizeof(struct editor_glyph_run) * row->glyph_capacity);
+    if (row->glyph_runs == NULL) {
+      die("realloc");
+    }
+  }
+  struct editor_glyph_run *run = &row->glyph_runs[row->num_glyph_runs++];
+  run->at = at;
+  run->column = column;
+  run->count = 1;
+  run->size = size;
+  run->width = width;
+  run->valid = valid;
+}
+
+// Rebuilds the row's glyph runs from its render. C1 control characters draw
+// as placeholders, the same as bytes that are not valid UTF-8.
+void editor_row_measure(editor_row *row) {
+  row->num_glyph_runs = 0;
+  const char *s = row->render;
+  int size = row->render_size;
+  int j = editor_ascii_prefix(s, size);
+  int column = j;
+  while (j < size) {
+    unsigned int code_point;
+    int len = editor_utf8_decode(&s[j], size - j, &code_point);
+    int valid = len > 0 && code_point >= 0xa0;
+    int width = valid ? editor_char_width(code_point) : 1;
+    if (len == 0) {
+      len = 1;
+    }
+    editor_row_add_glyph(row, j, column, len, width, valid);
+    j += len;
+    column += width;
+
+    int ascii = editor_ascii_prefix(&s[j], size - j);
+    j += ascii;
+    column += ascii;
+  }
+}
+
+int editor_glyph_run_end(struct editor_glyph_run *run) {
+  return run->at + run->count * run->size;
+}
+
+// Returns the first glyph run that ends past render byte at.
+int editor_row_find_glyph_run(editor_row *row, int at) {
+  int lo = 0;
+  int hi = row->num_glyph_runs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (editor_glyph_run_end(&row->glyph_runs[mid]) <= at) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Returns the screen column of render byte at. A byte inside a character
+// is on that character's column.
+int editor_row_render_to_column(editor_row *row, int at) {
+  int lo = 0;
+  int hi = row->num_glyph_runs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (row->glyph_runs[mid].at <= at) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo == 0) {
+    return at;
+  }
+
+  struct editor_glyph_run *run = &row->glyph_runs[lo - 1];
+  int end = editor_glyph_run_end(run);
+  if (at < end) {
+    return run->column + (at - run->at) / run->size * run->width;
+  }
+  return run->column + run->count * run->width + (at - end);
+}
+
+// Returns the render byte of the first character on screen column column or
+// past it. When column cuts a wide character in two, *pad is how many of its
+// columns come before that byte.
+int editor_row_column_to_render(editor_row *row, int column, int *pad) {
+  int lo = 0;
+  int hi = row->num_glyph_runs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (row->glyph_runs[mid].column < column) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  int at = column;
+  *pad = 0;
+  if (lo > 0) {
+    struct editor_glyph_run *run = &row->glyph_runs[lo - 1];
+    int end_column = run->column + run->count * run->width;
+    if (column < end_column) {
+      int k = (column - run->column + run->width - 1) / run->width;
+      at = run->at + k * run->size;
+      *pad = run->column + k * run->width - column;
+    } else {
+      at = editor_glyph_run_end(run) + (column - end_column);
+    }
+  }
+
+  // Marks there belong to the character before, which is off screen.
+  while (at > 0 && lo < row->num_glyph_runs &&
+         row->glyph_runs[lo].at == at && row->glyph_runs[lo].width == 0) {
+    at = editor_glyph_run_end(&row->glyph_runs[lo]);
+    lo++;
+  }
+  return at;
+}
+
+// Returns whether the len bytes at s start with a mark that takes no
+// columns.
+int editor_is_mark(const char *s, int len) {
+  unsigned int code_point;
+  return (unsigned char)s[0] >= 0x80 &&
+    editor_utf8_decode(s, len, &code_point) > 0 &&
+    editor_char_width(code_point) == 0;
+}
+
+// Returns where in chars the character after the one at cursor_x starts,
+// stepping over the marks that go with it.
+int editor_row_next_char(editor_row *row, int cursor_x) {
+  if (row->chunks) {
+    return cursor_x + 1;
+  }
+  int at = cursor_x;
+  do {
+    unsigned int code_point;
+    int len = editor_utf8_decode(&row->chars[at], row->size - at, &code_point);
+    at += len ? len : 1;
+  } while (at < row->size && editor_is_mark(&row->chars[at], row->size - at));
+  return at;
+}
+
+// Returns where in chars the character before cursor_x starts, along with
+// the marks that go with it.
+int editor_row_prev_char(editor_row *row, int cursor_x) {
+  if (row->chunks) {
+    return cursor_x - 1;
+  }
+  int at = cursor_x;
+  do {
+    at--;
+    int start = at;
+    while (start > 0 && at - start < 3 &&
+           (row->chars[start] & 0xc0) == 0x80) {
+      start--;
+    }
+    unsigned int code_point;
+    if (editor_utf8_decode(
+        &row->chars[start],
+        row->size - start,
+        &code_point) == at - start + 1) {
+      at = start;
+    }
+  } while (at > 0 && editor_is_mark(&row->chars[at], row->size - at));
+  return at;
+}
@@ -0,0 +1,591 @@
+#include "kilo.h"
+
+/*** read-only view ***/
+
+// A file opened as a view is never loaded. A scanner thread reads it once
+// from front to back, counting lines and remembering the offset of every
+// stride-th line start; when those marks outgrow their share of the memory
+// cap, the stride doubles and every other mark is dropped. Rows are decoded
+// from disk when they are first drawn, into slots picked by line number
+// modulo the slot count, and the least recently used slots off screen are
+// evicted whenever the decoded rows outgrow the rest of the cap.
+
+// Files bigger than half of physical memory are viewed rather than loaded.
+int editor_view_needed(char *filename) {
+  struct stat st;
+  if (stat(filename, &st) == -1 || !S_ISREG(st.st_mode)) {
+    return 0;
+  }
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (pages <= 0 || page_size <= 0) {
+    return 0;
+  }
+  return st.st_size > (off_t)pages * page_size / 2;
+}
+
+// Adds the offset of line, a multiple of the stride. Called with the lock
+// held.
+void editor_view_add_mark(struct editor_view *view, long line, off_t offset) {
+  if (view->num_marks == view->mark_capacity) {
+    size_t grown = view->mark_capacity ? view->mark_capacity * 2 : 1024;
+    if (grown * sizeof(off_t) <= view->mark_budget) {
+      view->mark_capacity = grown;
+      view->marks = realloc(view->marks, sizeof(off_t) * grown);
+      if (view->marks == NULL) {
+        die("realloc");
+      }
+    } else {
+      long j;
+      for (j = 0; j < (view->num_marks + 1) / 2; j++) {
+        view->marks[j] = view->marks[j * 2];
+      }
+      view->num_marks = (view->num_marks + 1) / 2;
+      view->stride *= 2;
+      if (line % view->stride != 0) {
+        return;
+      }
+    }
+  }
+  view->marks[view->num_marks++] = offset;
+}
+
+void *editor_view_scanner(void *arg) {
+  TRACE_SCOPE("editor_view_scanner");
+  struct editor_view *view = arg;
+  char *buffer = malloc(KILO_VIEW_SCAN);
+  if (buffer == NULL) {
+    die("malloc");
+  }
+
+  off_t offset = 0;
+  long lines = 0;
+  char last = '\n';
+  while (offset < view->size) {
+    pthread_mutex_lock(&view->lock);
+    int cancel = view->cancel;
+    pthread_mutex_unlock(&view->lock);
+    if (cancel) {
+      break;
+    }
+
+    ssize_t nread = pread(view->fd, buffer, KILO_VIEW_SCAN, offset);
+    if (nread <= 0) {
+      break;
+    }
+
+    // Only this thread changes the stride, so it can read it unlocked.
+    char *p = buffer;
+    char *end = buffer + nread;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+      p++;
+      lines++;
+      if (lines % view->stride == 0) {
+        pthread_mutex_lock(&view->lock);
+        editor_view_add_mark(view, lines, offset + (p - buffer));
+        pthread_mutex_unlock(&view->lock);
+      }
+    }
+    last = end[-1];
+    offset += nread;
+
+    pthread_mutex_lock(&view->lock);
+    view->newlines = lines;
+    view->scanned = offset;
+    pthread_cond_signal(&view->ready);
+    pthread_mutex_unlock(&view->lock);
+  }
+
+  pthread_mutex_lock(&view->lock);
+  view->lines = lines + (last != '\n');
+  view->done = 1;
+  pthread_cond_signal(&view->ready);
+  pthread_mutex_unlock(&view->lock);
+
+  free(buffer);
+  return NULL;
+}
+
+void editor_view_open(char *filename, size_t memory) {
+  TRACE_SCOPE("editor_view_open");
+  free(E.filename);
+  E.filename = strdup(filename);
+  editor_select_syntax_highlight();
+
+  struct editor_view *view = calloc(1, sizeof(*view));
+  if (view == NULL) {
+    die("calloc");
+  }
+  view->fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (view->fd == -1 || fstat(view->fd, &st) == -1) {
+    die("open");
+  }
+  posix_fadvise(view->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  view->size = st.st_size;
+
+  // A quarter of the cap goes to the line marks and half to decoded rows,
+  // which leaves the rest for the fixed read buffers and the slots.
+  if (memory < KILO_VIEW_MEMORY_MIN) {
+    memory = KILO_VIEW_MEMORY_MIN;
+  }
+  view->mark_budget = memory / 4;
+  view->cache_budget = memory / 2;
+  view->stride = 1024;
+  view->marks = malloc(sizeof(off_t) * 1024);
+  if (view->marks == NULL) {
+    die("malloc");
+  }
+  view->mark_capacity = 1024;
+  view->marks[0] = 0;
+  view->num_marks = 1;
+
+  view->num_slots = KILO_VIEW_SLOTS;
+  view->slots = malloc(sizeof(struct editor_view_slot) * view->num_slots);
+  if (view->slots == NULL) {
+    die("malloc");
+  }
+  int j;
+  for (j = 0; j < view->num_slots; j++) {
+    view->slots[j].line = -1;
+    editor_row_init(&view->slots[j].row, 0);
+  }
+  view->buffer = malloc(KILO_VIEW_LINE);
+  if (view->buffer == NULL) {
+    die("malloc");
+  }
+
+  pthread_mutex_init(&view->lock, NULL);
+  pthread_cond_init(&view->ready, NULL);
+  E.view = view;
+  E.num_rows = 0;
+  E.dirty = 0;
+
+  if (pthread_create(&view->thread, NULL, editor_view_scanner, view) != 0) {
+    die("pthread_create");
+  }
+}
+
+void editor_view_close(void) {
+  struct editor_view *view = E.view;
+  if (view == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&view->lock);
+  view->cancel = 1;
+  pthread_mutex_unlock(&view->lock);
+  pthread_join(view->thread, NULL);
+
+  int j;
+  for (j = 0; j < view->num_slots; j++) {
+    editor_free_row(&view->slots[j].row);
+  }
+  free(view->slots);
+  free(view->marks);
+  free(view->buffer);
+  free(view->search);
+  close(view->fd);
+  pthread_mutex_destroy(&view->lock);
+  pthread_cond_destroy(&view->ready);
+  free(view);
+  E.view = NULL;
+  E.num_rows = 0;
+}
+
+// Takes in the lines counted by the scanner, and returns whether the row
+// count changed.
+int editor_view_absorb(void) {
+  struct editor_view *view = E.view;
+  if (view == NULL) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&view->lock);
+  long lines = view->done ? view->lines : view->newlines;
+  pthread_mutex_unlock(&view->lock);
+
+  if (lines > INT_MAX) {
+    lines = INT_MAX;
+  }
+  if (lines == E.num_rows) {
+    return 0;
+  }
+  E.num_rows = lines;
+  return 1;
+}
+
+// Blocks until the scanner has counted at least rows lines or reached the
+// end of the file.
+void editor_view_wait(int rows) {
+  struct editor_view *view = E.view;
+  pthread_mutex_lock(&view->lock);
+  while (view->newlines < rows && !view->done) {
+    pthread_cond_wait(&view->ready, &view->lock);
+  }
+  pthread_mutex_unlock(&view->lock);
+  editor_view_absorb();
+}
+
+int editor_view_progress(void) {
+  struct editor_view *view = E.view;
+  pthread_mutex_lock(&view->lock);
+  int progress = view->size ? view->scanned * 100 / view->size : 100;
+  pthread_mutex_unlock(&view->lock);
+  return progress;
+}
+
+/*** view rows ***/
+
+// Returns the offset just past the count-th newline from offset on, or the
+// end of the file.
+off_t editor_view_skip(off_t offset, long count) {
+  struct editor_view *view = E.view;
+  while (count > 0 && offset < view->size) {
+    ssize_t nread = pread(view->fd, view->buffer, KILO_VIEW_LINE, offset);
+    if (nread <= 0) {
+      return view->size;
+    }
+    char *p = view->buffer;
+    char *end = view->buffer + nread;
+    while (count > 0 && (p = memchr(p, '\n', end - p)) != NULL) {
+      p++;
+      count--;
+    }
+    offset += (count > 0) ? nread : p - view->buffer;
+  }
+  return offset;
+}
+
+size_t editor_view_row_bytes(editor_row *row) {
+  return (row->block ? row->capacity : 0) +
+    row->render_capacity +
+    row->hl_capacity * sizeof(struct editor_hl_span) +
+    row->tab_capacity * sizeof(struct editor_tab_stop) +
+    row->glyph_capacity * sizeof(struct editor_glyph_run);
+}
+
+void editor_view_drop(struct editor_view_slot *slot) {
+  E.view->cache_bytes -= slot->bytes;
+  editor_free_row(&slot->row);
+  editor_row_init(&slot->row, 0);
+  slot->line = -1;
+  slot->bytes = 0;
+}
+
+// Frees the least recently used rows that are not on screen until the
+// decoded rows fit their budget again.
+void editor_view_evict(void) {
+  struct editor_view *view = E.view;
+  while (view->cache_bytes > view->cache_budget) {
+    struct editor_view_slot *victim = NULL;
+    int j;
+    for (j = 0; j < view->num_slots; j++) {
+      struct editor_view_slot *slot = &view->slots[j];
+      if (slot->line == -1 ||
+          (slot->line >= E.row_offset &&
+           slot->line < E.row_offset + E.screen_rows)) {
+        continue;
+      }
+      if (victim == NULL || slot->last_use < victim->last_use) {
+        victim = slot;
+      }
+    }
+    if (victim == NULL) {
+      return;
+    }
+    editor_view_drop(victim);
+  }
+}
+
+// Decodes the line starting at offset into its slot. Lines longer than
+// KILO_VIEW_LINE are cut short so that no single row can blow the cap.
+struct editor_view_slot *editor_view_load(int line, off_t offset) {
+  TRACE_SCOPE("editor_view_load");
+  struct editor_view *view = E.view;
+  ssize_t nread = pread(view->fd, view->buffer, KILO_VIEW_LINE, offset);
+  if (nread < 0) {
+    nread = 0;
+  }
+
+  char *nl = memchr(view->buffer, '\n', nread);
+  size_t len = nl ? (size_t)(nl - view->buffer) : (size_t)nread;
+  off_t next = offset + len + 1;
+  while (len > 0 && view->buffer[len - 1] == '\r') {
+    len--;
+  }
+
+  struct editor_view_slot *slot = &view->slots[line % view->num_slots];
+  if (slot->line != -1) {
+    editor_view_drop(slot);
+  }
+
+  editor_row *row = &slot->row;
+  editor_row_init(row, line);
+  editor_row_reserve(row, len + 1);
+  memcpy(row->chars, view->buffer, len);
+  row->chars[len] = '\0';
+  row->size = len;
+  editor_row_render(row);
+
+  if (nl == NULL) {
+    next = (nread == KILO_VIEW_LINE) ?
+      editor_view_skip(offset + nread, 1) :
+      offset + nread;
+  }
+
+  if (E.syntax) {
+    // Rows are decoded out of order, so a multi-line comment is only
+    // carried over from the row above when that row is cached.
+    struct editor_view_slot *above =
+      &view->slots[(line + view->num_slots - 1) % view->num_slots];
+    int in_comment = line > 0 && above->line == line - 1 &&
+      above->row.hl_open_comment;
+    unsigned char *hl = editor_highlight_scratch(row->render_size);
+    row->hl_open_comment =
+      editor_highlight_row(E.syntax, row, in_comment, hl);
+    editor_row_set_highlight(row, hl);
+  }
+
+  slot->line = line;
+  slot->offset = offset;
+  slot->next = next;
+  slot->last_use = ++view->clock;
+  slot->bytes = editor_view_row_bytes(row);
+  view->cache_bytes += slot->bytes;
+  editor_view_evict();
+  return slot;
+}
+
+// Returns the slot holding line at, decoding it from disk if needed. The
+// row stays valid until another row is decoded into the same slot or the
+// cache evicts it, which never happens to rows on screen.
+struct editor_view_slot *editor_view_slot(int at) {
+  struct editor_view *view = E.view;
+  struct editor_view_slot *slot = &view->slots[at % view->num_slots];
+  if (slot->line == at) {
+    slot->last_use = ++view->clock;
+    return slot;
+  }
+
+  // Scrolling down finds the row above cached, and with it the offset of
+  // this one. Otherwise start from the nearest mark and skip ahead.
+  struct editor_view_slot *above =
+    &view->slots[(at + view->num_slots - 1) % view->num_slots];
+  off_t offset;
+  if (at > 0 && above->line == at - 1) {
+    offset = above->next;
+  } else {
+    pthread_mutex_lock(&view->lock);
+    long mark = at / view->stride;
+    if (mark >= view->num_marks) {
+      mark = view->num_marks - 1;
+    }
+    long line = mark * view->stride;
+    offset = view->marks[mark];
+    pthread_mutex_unlock(&view->lock);
+    offset = editor_view_skip(offset, at - line);
+  }
+  return editor_view_load(at, offset);
+}
+
+editor_row *editor_view_row(int at) {
+  return &editor_view_slot(at)->row;
+}
+
+/*** view search ***/
+
+char *editor_view_search_buffer(void) {
+  struct editor_view *view = E.view;
+  if (view->search == NULL) {
+    view->search = malloc(KILO_VIEW_SCAN);
+    if (view->search == NULL) {
+      die("malloc");
+    }
+  }
+  return view->search;
+}
+
+long editor_view_count_newlines(const char *p, const char *end) {
+  long count = 0;
+  while ((p = memchr(p, '\n', end - p)) != NULL) {
+    p++;
+    count++;
+  }
+  return count;
+}
+
+// Streams forward from the start of line from, wrapping around at the end of
+// the file, and returns the line of the first match or -1.
+long editor_view_search_forward(const char *query, int from) {
+  struct editor_view *view = E.view;
+  char *search = editor_view_search_buffer();
+  size_t query_len = strlen(query);
+  off_t start = (from < E.num_rows) ? editor_view_slot(from)->offset : 0;
+  long line = (from < E.num_rows) ? from : 0;
+  off_t offset = start;
+  int wrapped = 0;
+
+  while (!wrapped || offset < start) {
+    ssize_t nread = pread(view->fd, search, KILO_VIEW_SCAN, offset);
+    if (nread <= 0) {
+      if (wrapped) {
+        break;
+      }
+      wrapped = 1;
+      offset = 0;
+      line = 0;
+      continue;
+    }
+
+    char *match = memmem(search, nread, query, query_len);
+    if (match && (!wrapped || offset + (match - search) < start)) {
+      return line + editor_view_count_newlines(search, match);
+    }
+
+    // Keep enough of the block to catch a match that straddles it.
+    ssize_t advance = nread;
+    if (nread == KILO_VIEW_SCAN && (size_t)nread > query_len) {
+      advance = nread - (query_len - 1);
+    }
+    line += editor_view_count_newlines(search, search + advance);
+    offset += advance;
+  }
+  return -1;
+}
+
+// Streams backward from the start of line from, wrapping around at the start
+// of the file, and returns the line of the last match before it or -1.
+long editor_view_search_backward(const char *query, int from) {
+  struct editor_view *view = E.view;
+  char *search = editor_view_search_buffer();
+  size_t query_len = strlen(query);
+  off_t start = (from < E.num_rows) ? editor_view_slot(from)->offset : 0;
+  long line = (from < E.num_rows) ? from : 0;
+  off_t end = start;
+  int wrapped = 0;
+  if (query_len >= KILO_VIEW_SCAN) {
+    return -1;
+  }
+
+  while (1) {
+    if (end == 0 || (wrapped && end <= start)) {
+      if (wrapped) {
+        return -1;
+      }
+      // Wrapping needs the number of the last line.
+      editor_view_wait(INT_MAX);
+      wrapped = 1;
+      end = view->size;
+      line = view->newlines;
+      continue;
+    }
+
+    // Overlap the block that was searched last by the length of the query,
+    // minus one, so that a match across the boundary is still seen. The
+    // overlap comes out of the block, which has to fit in the buffer.
+    off_t hi = end + query_len - 1;
+    if (hi > view->size || end == start) {
+      hi = end;
+    }
+    off_t lo = hi > KILO_VIEW_SCAN ? hi - KILO_VIEW_SCAN : 0;
+    if (wrapped && lo < start) {
+      lo = start;
+    }
+    ssize_t nread = pread(view->fd, search, hi - lo, lo);
+    if (nread <= 0) {
+      return -1;
+    }
+
+    char *last = NULL;
+    char *p = search;
+    char *match;
+    while ((match = memmem(p, nread - (p - search), query, query_len)) &&
+           lo + (match - search) < end) {
+      last = match;
+      p = match + 1;
+    }
+    if (last) {
+      return line - editor_view_count_newlines(last, search + (end - lo));
+    }
+
+    line -= editor_view_count_newlines(search, search + (end - lo));
+    end = lo;
+  }
+}
+
+void editor_view_find_callback(char *query, int key) {
+  TRACE_SCOPE("editor_view_find_callback");
+  static int last_match = -1;
+  static int saved_highlight_line = -1;
+  static unsigned char *saved_highlight = NULL;
+  struct editor_view *view = E.view;
+
+  if (saved_highlight) {
+    struct editor_view_slot *slot =
+      &view->slots[saved_highlight_line % view->num_slots];
+    if (slot->line == saved_highlight_line) {
+      editor_row_set_highlight(&slot->row, saved_highlight);
+    }
+    free(saved_highlight);
+    saved_highlight = NULL;
+  }
+
+  // Streaming a huge file on every keystroke would stall typing, so the
+  // view only searches on Enter and the arrow keys.
+  int direction;
+  if (key == '\x1b' || (key == '\r' && last_match != -1)) {
+    last_match = -1;
+    return;
+  } else if (key == '\r' || key == ARROW_RIGHT || key == ARROW_DOWN) {
+    direction = 1;
+  } else if (key == ARROW_LEFT || key == ARROW_UP) {
+    direction = -1;
+  } else {
+    last_match = -1;
+    return;
+  }
+  if (query[0] == '\0') {
+    return;
+  }
+
+  long line;
+  if (direction == 1) {
+    line = editor_view_search_forward(
+      query,
+      last_match == -1 ? E.cursor_y : last_match + 1);
+  } else {
+    line = editor_view_search_backward(
+      query,
+      last_match == -1 ? E.cursor_y : last_match);
+  }
+  if (key == '\r') {
+    last_match = -1;
+  }
+  if (line == -1 || line >= INT_MAX) {
+    return;
+  }
+
+  editor_view_wait(line + 1);
+  if (key != '\r') {
+    last_match = line;
+  }
+  editor_row *row = editor_view_row(line);
+  char *match = strstr(row->render, query);
+  E.cursor_y = line;
+  E.cursor_x = match ?
+    eidtor_row_render_x_to_cursor_x(row, match - row->render) :
+    0;
+  E.row_offset = E.num_rows;
+
+  if (match) {
+    saved_highlight_line = line;
+    saved_highlight = malloc(row->render_size);
+    editor_row_get_highlight(row, saved_highlight);
+
+    unsigned char *hl = editor_highlight_scratch(row->render_size);
+    memcpy(hl, saved_highlight, row->render_size);
+    memset(&hl[match - row->render], HL_MATCH, strlen(query));
+    editor_row_set_highlight(row, hl);
+  }
+}
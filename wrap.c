@@ -0,0 +1,505 @@
+#include "kilo.h"
+
+/*** soft wrap ***/
+
+// With soft wrap on, a row too wide for the screen carries on over as many
+// lines as it needs instead of scrolling sideways. Rows are measured from
+// their chars, so one the cache evicted does not have to be rendered again
+// to be measured, and a long row in chunks breaks every width columns.
+
+// Returns how many screen lines row takes at width columns, storing the
+// column each one starts at in starts unless it is NULL, which then needs
+// room for row->size + 1. Lines break after the last space or tab that
+// fits, or mid-word when there is none. Columns are counted the way
+// editor_row_render and editor_row_measure lay the row out.
+int editor_wrap_breaks(editor_row *row, int width, int *starts) {
+  if (starts) {
+    starts[0] = 0;
+  }
+  if (row->chunks) {
+    int columns = row->chunks->width;
+    return columns > width ? (columns + width - 1) / width : 1;
+  }
+
+  int lines = 1;
+  int line_start = 0;
+  int space_end = -1;
+  int column = 0;
+  int at = 0;
+  int j = 0;
+  while (j < row->size) {
+    unsigned char c = row->chars[j];
+    int len = 1;
+    int columns = 1;
+    int space = 0;
+    if (c == '\t') {
+      // Tab stops fall on render bytes, as in editor_row_render.
+      columns = KILO_TAB_STOP - at % KILO_TAB_STOP;
+      space = 1;
+      at += columns;
+    } else if (c < 0x80) {
+      space = c == ' ';
+      at++;
+    } else {
+      unsigned int code_point;
+      len = editor_utf8_decode(&row->chars[j], row->size - j, &code_point);
+      if (len > 0 && code_point >= 0xa0) {
+        columns = editor_char_width(code_point);
+      }
+      if (len == 0) {
+        len = 1;
+      }
+      at += len;
+    }
+
+    if (column + columns - line_start > width && column > line_start) {
+      line_start = space_end > line_start ? space_end : column;
+      if (starts) {
+        starts[lines] = line_start;
+      }
+      lines++;
+      // What came after the space can still be too wide with c.
+      if (column + columns - line_start > width && column > line_start) {
+        line_start = column;
+        if (starts) {
+          starts[lines] = line_start;
+        }
+        lines++;
+      }
+    }
+    column += columns;
+    if (space) {
+      space_end = column;
+    }
+    j += len;
+  }
+  return lines;
+}
+
+// Lays out row at into wrap->starts and returns its number of lines. A row
+// in chunks leaves starts alone, since its lines start every width columns.
+int editor_wrap_layout(int at) {
+  struct editor_wrap *wrap = E.wrap;
+  editor_row *row = &E.row[at];
+  if (row->chunks) {
+    return editor_wrap_breaks(row, wrap->width, NULL);
+  }
+  if (row->size + 1 > wrap->start_capacity) {
+    wrap->start_capacity = editor_grow_capacity(
+      wrap->start_capacity,
+      row->size + 1);
+    free(wrap->starts);
+    wrap->starts = malloc(sizeof(int) * wrap->start_capacity);
+    if (wrap->starts == NULL) {
+      die("malloc");
+    }
+  }
+  return editor_wrap_breaks(row, wrap->width, wrap->starts);
+}
+
+// The column line of row at starts on, as laid out by editor_wrap_layout.
+int editor_wrap_line_start(int at, int line) {
+  struct editor_wrap *wrap = E.wrap;
+  return E.row[at].chunks ? line * wrap->width : wrap->starts[line];
+}
+
+/*** line counts ***/
+
+// wrap->tree is a Fenwick tree over wrap->lines, so the screen line a row
+// starts on and the row a screen line falls in both take O(log n).
+
+// Rebuilds the nodes of the tree that cover rows from wrap->stale on. The
+// others only sum rows above it, which have not moved, so an edit near the
+// end of a huge file costs little more than one near the end of a small
+// one.
+void editor_wrap_build(void) {
+  struct editor_wrap *wrap = E.wrap;
+  int j;
+  for (j = wrap->stale + 1; j <= wrap->num_rows; j++) {
+    // Node j sums row j - 1 and the nodes j - 1, j - 2, j - 4 and so on
+    // that make up the rest of its range.
+    int step;
+    wrap->tree[j] = wrap->lines[j - 1];
+    for (step = 1; step < (j & -j); step *= 2) {
+      wrap->tree[j] += wrap->tree[j - step];
+    }
+  }
+  wrap->stale = wrap->num_rows;
+}
+
+void editor_wrap_add(int at, int delta) {
+  struct editor_wrap *wrap = E.wrap;
+  int j;
+  for (j = at + 1; j <= wrap->num_rows; j += j & -j) {
+    wrap->tree[j] += delta;
+  }
+}
+
+// Returns how many screen lines the rows before at take.
+int editor_wrap_prefix(int at) {
+  struct editor_wrap *wrap = E.wrap;
+  int lines = 0;
+  int j;
+  for (j = at; j > 0; j -= j & -j) {
+    lines += wrap->tree[j];
+  }
+  return lines;
+}
+
+// Returns the row screen line line falls in, or num_rows past the last one.
+int editor_wrap_find(int line) {
+  struct editor_wrap *wrap = E.wrap;
+  int step = 1;
+  while (step * 2 <= wrap->num_rows) {
+    step *= 2;
+  }
+  int at = 0;
+  for (; step > 0; step /= 2) {
+    if (at + step <= wrap->num_rows && wrap->tree[at + step] <= line) {
+      at += step;
+      line -= wrap->tree[at];
+    }
+  }
+  return at;
+}
+
+void editor_wrap_reserve(int num_rows) {
+  struct editor_wrap *wrap = E.wrap;
+  if (num_rows <= wrap->capacity) {
+    return;
+  }
+  wrap->capacity = editor_grow_capacity(wrap->capacity, num_rows);
+  wrap->lines = realloc(wrap->lines, sizeof(int) * wrap->capacity);
+  wrap->widths = realloc(wrap->widths, sizeof(int) * wrap->capacity);
+  wrap->tree = realloc(wrap->tree, sizeof(int) * (wrap->capacity + 1));
+  if (wrap->lines == NULL || wrap->widths == NULL || wrap->tree == NULL) {
+    die("realloc");
+  }
+}
+
+// Measures row at again at the current width, after it changed or when it
+// was last measured at another one.
+void editor_wrap_measure(int at) {
+  struct editor_wrap *wrap = E.wrap;
+  int lines = editor_wrap_breaks(&E.row[at], wrap->width, NULL);
+  if (at < wrap->stale) {
+    editor_wrap_add(at, lines - wrap->lines[at]);
+  }
+  wrap->lines[at] = lines;
+  wrap->widths[at] = wrap->width;
+}
+
+void editor_wrap_refresh(int at) {
+  if (E.wrap->widths[at] != E.wrap->width) {
+    editor_wrap_measure(at);
+  }
+}
+
+// Catches up with the screen width and with rows appended in bulk. Rows
+// nobody has measured at the current width count what they did before, or
+// one line, until editor_wrap_idle or the screen gets to them.
+void editor_wrap_sync(void) {
+  struct editor_wrap *wrap = E.wrap;
+  int width = E.screen_cols > 0 ? E.screen_cols : 1;
+  if (wrap->width != width) {
+    wrap->width = width;
+    wrap->next = 0;
+  }
+  if (wrap->num_rows < E.num_rows) {
+    editor_wrap_reserve(E.num_rows);
+    int j;
+    for (j = wrap->num_rows; j < E.num_rows; j++) {
+      wrap->lines[j] = 1;
+      wrap->widths[j] = 0;
+    }
+    if (wrap->next > wrap->num_rows) {
+      wrap->next = wrap->num_rows;
+    }
+    if (wrap->stale > wrap->num_rows) {
+      wrap->stale = wrap->num_rows;
+    }
+    wrap->num_rows = E.num_rows;
+  }
+  if (wrap->stale < wrap->num_rows) {
+    editor_wrap_build();
+  }
+}
+
+/*** edits ***/
+
+// Called by editor_update_row. Only the row's own count changes.
+void editor_wrap_update(editor_row *row) {
+  if (E.wrap == NULL || row->idx >= E.wrap->num_rows) {
+    return;
+  }
+  editor_wrap_measure(row->idx);
+}
+
+// A row was inserted (delta 1) or deleted (delta -1) at at. The counts move
+// along with the rows, and the tree from at on is rebuilt before it is
+// next used, once however many rows moved in between.
+void editor_wrap_shift(int at, int delta) {
+  struct editor_wrap *wrap = E.wrap;
+  if (wrap == NULL || at > wrap->num_rows ||
+      (delta < 0 && at == wrap->num_rows)) {
+    return;
+  }
+  if (delta > 0) {
+    editor_wrap_reserve(wrap->num_rows + 1);
+    memmove(
+      &wrap->lines[at + 1],
+      &wrap->lines[at],
+      sizeof(int) * (wrap->num_rows - at));
+    memmove(
+      &wrap->widths[at + 1],
+      &wrap->widths[at],
+      sizeof(int) * (wrap->num_rows - at));
+    wrap->lines[at] = 1;
+    wrap->widths[at] = 0;
+  } else {
+    memmove(
+      &wrap->lines[at],
+      &wrap->lines[at + 1],
+      sizeof(int) * (wrap->num_rows - at - 1));
+    memmove(
+      &wrap->widths[at],
+      &wrap->widths[at + 1],
+      sizeof(int) * (wrap->num_rows - at - 1));
+  }
+  wrap->num_rows += delta;
+  if (at < wrap->next) {
+    wrap->next += delta;
+  }
+  if (at < wrap->stale) {
+    wrap->stale = at;
+  }
+}
+
+/*** background ***/
+
+// Rewraps rows measured at another width, from next on, for up to
+// KILO_WRAP_BUDGET seconds, and returns whether there were any. Called
+// between keys, so a resize of a huge file is rewrapped a slice at a time
+// while the rows on screen are measured as they are drawn.
+int editor_wrap_idle(void) {
+  if (!editor_wrap_enabled()) {
+    return 0;
+  }
+  struct editor_wrap *wrap = E.wrap;
+  editor_wrap_sync();
+  if (wrap->next >= wrap->num_rows) {
+    return 0;
+  }
+
+  double deadline = editor_stats_now() + KILO_WRAP_BUDGET;
+  while (wrap->next < wrap->num_rows) {
+    editor_wrap_refresh(wrap->next++);
+    if (wrap->next % 4096 == 0 && editor_stats_now() > deadline) {
+      break;
+    }
+  }
+  return 1;
+}
+
+int editor_wrap_progress(void) {
+  struct editor_wrap *wrap = E.wrap;
+  return wrap->num_rows ? (int)((long)wrap->next * 100 / wrap->num_rows) : 100;
+}
+
+/*** toggle ***/
+
+// Soft wrap is left alone while the screen is split, and panes scroll
+// sideways as before.
+int editor_wrap_enabled(void) {
+  return E.wrap && E.panes == NULL;
+}
+
+void editor_wrap_free(void) {
+  struct editor_wrap *wrap = E.wrap;
+  if (wrap == NULL) {
+    return;
+  }
+  free(wrap->lines);
+  free(wrap->widths);
+  free(wrap->tree);
+  free(wrap->starts);
+  free(wrap);
+  E.wrap = NULL;
+}
+
+void editor_wrap_toggle(void) {
+  if (E.wrap) {
+    editor_wrap_free();
+    editor_set_status_message("Soft wrap off");
+    return;
+  }
+  if (E.view) {
+    editor_set_status_message("Soft wrap is not available in a view");
+    return;
+  }
+  E.wrap = calloc(1, sizeof(struct editor_wrap));
+  if (E.wrap == NULL) {
+    die("calloc");
+  }
+  E.col_offset = 0;
+  editor_set_status_message(
+    E.panes ? "Soft wrap on, once the screen is not split" : "Soft wrap on");
+}
+
+/*** scrolling ***/
+
+// Returns the line of row at that screen column column is on, with the row
+// laid out by editor_wrap_layout, which returned lines.
+int editor_wrap_locate(int at, int lines, int column) {
+  struct editor_wrap *wrap = E.wrap;
+  if (E.row[at].chunks) {
+    int line = column / wrap->width;
+    return line < lines ? line : lines - 1;
+  }
+  int lo = 1;
+  int hi = lines;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (wrap->starts[mid] <= column) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+// editor_scroll for soft wrap. Scrolling is in screen lines: the top of the
+// screen is line line_offset of row row_offset, and the cursor is kept
+// between it and the bottom.
+void editor_wrap_scroll(void) {
+  struct editor_wrap *wrap = E.wrap;
+  editor_wrap_sync();
+  E.col_offset = 0;
+
+  // These rows can end up on screen, so their counts have to be right for
+  // the cursor to land where it is drawn.
+  int at = E.cursor_y > E.screen_rows ? E.cursor_y - E.screen_rows : 0;
+  for (; at <= E.cursor_y && at < wrap->num_rows; at++) {
+    editor_wrap_refresh(at);
+  }
+  for (at = E.row_offset;
+       at < E.row_offset + E.screen_rows && at < wrap->num_rows;
+       at++) {
+    editor_wrap_refresh(at);
+  }
+
+  E.render_x = E.cursor_x;
+  int line = 0;
+  int x = 0;
+  if (E.cursor_y < E.num_rows) {
+    editor_row *row = editor_row_at(E.cursor_y);
+    E.render_x = editor_row_render_to_column(
+      row,
+      editor_row_cursor_x_to_render_x(row, E.cursor_x));
+    int lines = editor_wrap_layout(E.cursor_y);
+    line = editor_wrap_locate(E.cursor_y, lines, E.render_x);
+    x = E.render_x - editor_wrap_line_start(E.cursor_y, line);
+    if (x >= wrap->width) {
+      x = wrap->width - 1;
+    }
+  }
+  int cursor = editor_wrap_prefix(E.cursor_y) + line;
+
+  if (E.row_offset < wrap->num_rows &&
+      wrap->line_offset >= wrap->lines[E.row_offset]) {
+    wrap->line_offset = wrap->lines[E.row_offset] - 1;
+  }
+  int top = editor_wrap_prefix(E.row_offset) + wrap->line_offset;
+  if (cursor < top) {
+    top = cursor;
+  }
+  if (cursor >= top + E.screen_rows) {
+    top = cursor - E.screen_rows + 1;
+  }
+  E.row_offset = editor_wrap_find(top);
+  wrap->line_offset = top - editor_wrap_prefix(E.row_offset);
+  wrap->cursor_y = cursor - top;
+  wrap->cursor_x = x;
+  editor_wait_rows(E.row_offset + E.screen_rows);
+}
+
+// PAGE_UP and PAGE_DOWN for soft wrap: a screen of lines up or down, with
+// the cursor at the start of the line it lands on.
+void editor_wrap_page(int key) {
+  struct editor_wrap *wrap = E.wrap;
+  if (key == PAGE_DOWN) {
+    editor_wait_rows(E.row_offset + 2 * E.screen_rows);
+  }
+  editor_wrap_sync();
+  int top = editor_wrap_prefix(E.row_offset) + wrap->line_offset;
+  int target = key == PAGE_UP ?
+    top - E.screen_rows :
+    top + 2 * E.screen_rows - 1;
+  if (target < 0) {
+    target = 0;
+  }
+
+  E.cursor_x = 0;
+  E.cursor_y = editor_wrap_find(target);
+  if (E.cursor_y >= E.num_rows) {
+    E.cursor_y = E.num_rows;
+    return;
+  }
+  int line = target - editor_wrap_prefix(E.cursor_y);
+  editor_wrap_refresh(E.cursor_y);
+  int lines = editor_wrap_layout(E.cursor_y);
+  if (line >= lines) {
+    line = lines - 1;
+  }
+  if (line > 0) {
+    int pad;
+    editor_row *row = editor_row_at(E.cursor_y);
+    int render_x = editor_row_column_to_render(
+      row,
+      editor_wrap_line_start(E.cursor_y, line),
+      &pad);
+    E.cursor_x = eidtor_row_render_x_to_cursor_x(row, render_x);
+  }
+}
+
+/*** output ***/
+
+void editor_wrap_draw_rows(struct append_buffer *append_buffer) {
+  struct editor_wrap *wrap = E.wrap;
+  // Rows can have come in from the indexer since editor_wrap_scroll.
+  editor_wrap_sync();
+  int screen_cols = E.screen_cols;
+  int at = E.row_offset;
+  int line = wrap->line_offset;
+  int y = 0;
+  while (y < E.screen_rows) {
+    if (at >= E.num_rows) {
+      editor_draw_empty(append_buffer, y);
+      append_buffer_append(append_buffer, "\x1b[K", 3);
+      append_buffer_append(append_buffer, "\r\n", 2);
+      y++;
+      continue;
+    }
+
+    editor_wrap_refresh(at);
+    int lines = editor_wrap_layout(at);
+    for (; line < lines && y < E.screen_rows; line++, y++) {
+      int start = editor_wrap_line_start(at, line);
+      int end = line + 1 < lines ?
+        editor_wrap_line_start(at, line + 1) :
+        start + wrap->width;
+      // A row in chunks renders the window of columns being drawn.
+      E.col_offset = start;
+      E.screen_cols = end - start;
+      editor_row *row = editor_row_at(at);
+      editor_draw_columns(append_buffer, row, start, end - start);
+      append_buffer_append(append_buffer, "\x1b[K", 3);
+      append_buffer_append(append_buffer, "\r\n", 2);
+    }
+    line = 0;
+    at++;
+  }
+  E.col_offset = 0;
+  E.screen_cols = screen_cols;
+}